@@ -1,5 +1,9 @@
 #include <Arduino.h>
+#if defined(__AVR__)
+#    include <avr/sleep.h>
+#endif
 #include "Expander.h"
+#include "EventLoop.h"
 #include "gpio_pin.h"
 #include "gpiomap.h"
 
@@ -40,6 +44,20 @@ void poll_extra() {
     expander_poll();
 }
 
+// Sleep until the next interrupt.  The UART receive interrupt and the
+// millisecond timer both end the sleep, so input pins are still checked
+// at least once per millisecond.
+void event_sleep(int timeout_ms) {
+#if defined(__AVR__)
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#elif defined(ARDUINO_ARCH_STM32)
+    __WFI();
+#elif defined(ESP32) || defined(ESP8266)
+    delay(1);  // Lets the RTOS idle
+#endif
+}
+
 void setup() {
     init_gpiomap();
 
@@ -54,4 +72,7 @@ void setup() {
 }
 void loop() {
     fnc_poll();
+    if (!FNCSerial.available()) {
+        event_wait();
+    }
 }
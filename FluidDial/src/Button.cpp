@@ -2,77 +2,142 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include "Button.h"
+#include "EventLoop.h"
 
-const int debounce_ms = 10;
+// The fast path runs beside the ingest task on core 0, at a higher
+// priority, so it is not held up by the loop or by a line being sent
+constexpr static const int FAST_PATH_CORE       = 0;
+constexpr static const int FAST_PATH_PRIORITY   = 5;
+constexpr static const int FAST_PATH_STACK_SIZE = 2048;
+
+constexpr static const int MAX_BUTTONS = 8;
+
+static Button*      buttons[MAX_BUTTONS];
+static int          n_buttons = 0;
+static TaskHandle_t fast_task = nullptr;
+
+static bool after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+static void button_isr(void* arg) {
+    static_cast<Button*>(arg)->isr();
+}
+
+void Button::isr() {
+    bool value = read();
+    _edges.push({ (uint32_t)micros(), value });
+    if (value && _action != None && fast_task) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(fast_task, 1 << _index, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    event_wake(EV_WAKE_GPIO);
+}
+
+// Send the armed command if the button is still down after the deglitch time
+void Button::fire() {
+    realtime_cmd_t action = _action;
+    if (action == None || !read() || _claimed.exchange(true)) {
+        return;
+    }
+    fnc_realtime(action);
+    fnc_realtime(StatusReport);
+}
+
+static void fast_path_loop(void* arg) {
+    while (true) {
+        uint32_t pressed;
+        xTaskNotifyWait(0, UINT32_MAX, &pressed, portMAX_DELAY);
+        vTaskDelay(1);  // Deglitch
+        for (int i = 0; i < n_buttons; i++) {
+            if (pressed & (1 << i)) {
+                buttons[i]->fire();
+            }
+        }
+    }
+}
 
 void Button::init(uint8_t pin, bool active_low) {
     _pin_num    = pin;
     _active_low = active_low;
+    _index      = n_buttons;
+
+    buttons[n_buttons++] = this;
+    if (!fast_task) {
+        xTaskCreatePinnedToCore(fast_path_loop, "buttons", FAST_PATH_STACK_SIZE, nullptr, FAST_PATH_PRIORITY, &fast_task, FAST_PATH_CORE);
+    }
     pinMode(_pin_num, INPUT_PULLUP);
-    _last_value = read();
-    _state      = STABLE;
+    _value = _last_value = read();
+    attachInterruptArg(_pin_num, button_isr, this, CHANGE);
 }
 
 bool Button::read() {
     return digitalRead(_pin_num) ^ _active_low;
 }
 
-// Waiting from the time to expire
-bool Button::waiting() {
-    return ((int32_t)millis() - _end_time) < 0;
+bool Button::busy() {
+    return _have_edge || _have_candidate || _debouncing || !_edges.empty();
 }
-bool Button::pin_changed() {
-    bool new_value;
-    new_value = read();
-    if (new_value != _last_value) {
-        _last_value = new_value;
-        return true;
+
+bool Button::report(bool value, uint32_t time_us, bool& result) {
+    _last_value = value;
+    _change_us  = time_us;
+    if (!value) {
+        _claimed = false;  // The next press is a new one
     }
-    return false;
+    result = value;
+    return true;
 }
 
+// Edges are handled in order, so a press and release that both happen
+// during a slow pass are reported one after the other.
 bool Button::changed(bool& value) {
-    switch (_state) {
-        case STABLE:
-            if (pin_changed()) {
-                _end_time = (int32_t)millis() + DEGLITCH_MS;
-                _state    = DEGLITCHING;
+    uint32_t now = micros();
+    while (true) {
+        if (!_have_edge) {
+            _have_edge = _edges.pop(_edge);
+        }
+        if (_debouncing) {
+            if (!after(_have_edge ? _edge.time_us : now, _quiet_us)) {
+                if (!_have_edge) {
+                    return false;
+                }
+                _value     = _edge.value;  // Bounce
+                _have_edge = false;
+                continue;
             }
-            return false;
-        case DEGLITCHING:
-            if (waiting()) {
-                return false;
+            _debouncing = false;
+            if (_value != _last_value) {
+                // The pin changed during the debounce time, so the
+                // button is not being held
+                return report(_value, _quiet_us, value);
             }
-            if (pin_changed()) {
-                // The pin changed since the start of the deglitch period
-                // so it was a glitch.
-                _state = STABLE;
-                return false;
+        }
+        if (_have_candidate) {
+            if (_have_edge && !after(_edge.time_us, _candidate.time_us + DEGLITCH_US)) {
+                // The pin changed during the deglitch time, so it was a glitch
+                _value          = _edge.value;
+                _have_edge      = false;
+                _have_candidate = _edge.value == _candidate.value;
+                continue;
             }
-            // The value is the same as at the start of the deglitch period
-            // so it is a true change
-            _end_time = (int32_t)millis() + DEBOUNCE_MS;
-            _state    = DEBOUNCING;
-            value     = _last_value;
-            return true;
-        case DEBOUNCING:
-            if (waiting()) {
+            if (!_have_edge && !after(now, _candidate.time_us + DEGLITCH_US)) {
                 return false;
             }
-            // We always return to idle at the end of a debounce
-            _state = STABLE;
-
-            if (pin_changed()) {
-                // The pin changed since the start of the debounce period
-                // so the button is not being held
-                value = _last_value;
-                return true;
-            }
-            // The button is at the same state as at the end of the deglitch
-            // period.  Since we have returned to STABLE state, on the next
-            // pin change the state machine will start again and possibly
-            // report the change after a deglitch delay.
+            _have_candidate = false;
+            _debouncing     = true;
+            _quiet_us       = _candidate.time_us + DEBOUNCE_US;
+            return report(_candidate.value, _candidate.time_us, value);
+        }
+        if (!_have_edge) {
             return false;
+        }
+        _value     = _edge.value;
+        _have_edge = false;
+        if (_value != _last_value) {
+            _candidate      = { _edge.time_us, _value };
+            _have_candidate = true;
+        }
     }
-    return false;
 }
@@ -2,26 +2,64 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include <Arduino.h>
+#include <atomic>
+#include "GrblParserC.h"  // realtime_cmd_t
+#include "SPSCRing.h"
 
+// Edges are timestamped by the pin interrupt and debounced by
+// changed() on those timestamps, so a slow pass through the loop
+// delays a press but does not lose it or change its timing.
+//
+// A button can also be armed with a realtime command, such as Reset
+// for an E-Stop legend.  Then a high-priority task sends the command
+// as soon as a press has outlasted the deglitch time, without waiting
+// for the loop, and changed() still reports the press.
 class Button {
 public:
     void init(uint8_t pin_num, bool activeLow);
     bool read();
     bool changed(bool& value);
+    bool busy();  // Deglitching or debouncing
+
+    // Time of the change last reported by changed()
+    uint32_t change_us() { return _change_us; }
+
+    // The command for the fast path to send on a press, or None
+    void arm(realtime_cmd_t action) { _action = action; }
+
+    // For a press reported by changed(): true unless the fast path has
+    // already sent the command, so the scene should not act on it again
+    bool claim() { return !_claimed.exchange(true); }
+
+    void isr();   // Pin interrupt
+    void fire();  // Fast path task
 
 private:
-    enum debounce_state {
-        STABLE      = 0,
-        DEGLITCHING = 1,
-        DEBOUNCING  = 2,
+    struct edge {
+        uint32_t time_us;
+        bool     value;
     };
-    const int DEGLITCH_MS = 1;
-    const int DEBOUNCE_MS = 30;
-    uint8_t   _state;
-    uint8_t   _pin_num;
-    bool      _active_low;
-    bool      _last_value = false;
-    int32_t   _end_time   = 0;
-    bool      waiting();
-    bool      pin_changed();
+    const uint32_t DEGLITCH_US = 1000;
+    const uint32_t DEBOUNCE_US = 30000;
+
+    uint8_t _pin_num;
+    bool    _active_low;
+    uint8_t _index;
+
+    SPSCRing<edge, 16> _edges;  // ISR -> changed()
+
+    edge     _edge;  // Taken from _edges, not yet handled
+    bool     _have_edge = false;
+    edge     _candidate;  // A change waiting out the deglitch time
+    bool     _have_candidate = false;
+    bool     _debouncing     = false;
+    uint32_t _quiet_us;            // End of the debounce time
+    bool     _value      = false;  // Pin value after the last edge
+    bool     _last_value = false;  // Last value reported by changed()
+    uint32_t _change_us  = 0;
+
+    std::atomic<realtime_cmd_t> _action { None };
+    std::atomic<bool>           _claimed { false };
+
+    bool report(bool value, uint32_t time_us, bool& result);
 };
@@ -13,7 +13,7 @@ public:
 
     void onDialButtonPress() { pop_scene(); }
     void onGreenButtonPress() {
-        String line = "";
+        const char* line = "";
         switch (state) {
             case Idle:
                 switch (current_button) {
@@ -32,7 +32,7 @@ public:
                     default:
                         break;
                 }
-                debug_println(line.c_str());
+                debug_println(line);
                 send_line(line);
                 break;
             case Cycle:
@@ -43,6 +43,9 @@ public:
                 break;
         }
     }
+    realtime_cmd_t redFastAction() override { return (state == Cycle || state == Hold) ? Reset : None; }
+    realtime_cmd_t greenFastAction() override { return state == Cycle ? FeedHold : None; }
+
     void onRedButtonPress() {
         switch (state) {
             case Cycle:
@@ -59,14 +62,17 @@ public:
         ackBeep();
     }
 
-    void onDROChange() { reDisplay(); }
+    void onDROChange() { redrawIfChanged(); }
+
+    void hashInputs(FrameHash& hash) override { hashStatus(hash); }
 
     void reDisplay() {
         drawBackground(BLACK);
         drawMenuTitle(current_scene->name());
         drawStatus();
 
-        String redLabel, grnLabel = "";
+        const char* redLabel = "";
+        const char* grnLabel = "";
 
         if (state == Idle) {
             int x      = 50;
@@ -2,11 +2,15 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include "Drawing.h"
+#include "Scene.h"  // current_scene
 #include "alarm.h"
+#include "Profiler.h"
+#include "Format.h"
 #include <map>
 #include <LittleFS.h>
 
 void drawBackground(int color) {
+    profile_begin(PROF_COMPOSE);
     canvas.fillSprite(color);
 }
 
@@ -102,6 +106,14 @@ void drawStatus() {
     }
 }
 
+static bool error_showing() {
+    return (milliseconds() - errorExpire) < 0;
+}
+
+void hashStatus(FrameHash& hash) {
+    hash.add(state).add(stateString).add(lastAlarm).add(error_showing());
+}
+
 void drawStatusTiny(int y) {
     static constexpr int width  = 90;
     static constexpr int height = 20;
@@ -112,17 +124,17 @@ void drawStatusTiny(int y) {
 
 Stripe::Stripe(int x, int y, int width, int height, fontnum_t font) : _x(x), _y(y), _width(width), _height(height), _font(font) {}
 
-void Stripe::draw(const String& left, const String& right, bool highlighted, int left_color) {
+void Stripe::draw(const char* left, const char* right, bool highlighted, int left_color) {
     drawOutlinedRect(_x, _y, _width, _height, highlighted ? BLUE : NAVY, WHITE);
-    if (left.length()) {
+    if (*left) {
         text(left, text_left_x(), text_middle_y(), left_color, _font, middle_left);
     }
-    if (right.length()) {
+    if (*right) {
         text(right, text_right_x(), text_middle_y(), WHITE, _font, middle_right);
     }
     _y += gap();
 }
-void Stripe::draw(const String& center, bool highlighted) {
+void Stripe::draw(const char* center, bool highlighted) {
     drawOutlinedRect(_x, _y, _width, _height, highlighted ? BLUE : NAVY, WHITE);
     text(center, text_center_x(), text_middle_y(), WHITE, _font, middle_center);
     _y += gap();
@@ -132,14 +144,18 @@ void Stripe::draw(const String& center, bool highlighted) {
 #define DIAL_BUTTON_LINE 228
 
 // This shows on the display what the button currently do.
-void drawButtonLegends(const String& red, const String& green, const String& orange) {
+void drawButtonLegends(const char* red, const char* green, const char* orange) {
     text(red, 80, PUSH_BUTTON_LINE, RED);
     text(green, 160, PUSH_BUTTON_LINE, GREEN);
     centered_text(orange, DIAL_BUTTON_LINE, ORANGE);
 }
 
 void DRO::draw(int axis, bool highlight) {
-    Stripe::draw(axisNumToString(axis), floatToString(myAxes[axis], 2), highlight, myLimitSwitches[axis] ? GREEN : WHITE);
+    Stripe::draw(AxisName(axis), Fixed(myAxes[axis], 2), highlight, myLimitSwitches[axis] ? GREEN : WHITE);
+}
+
+void DRO::hash(FrameHash& hash, int axis) {
+    hash.add(myAxes[axis], 2).add(myLimitSwitches[axis]);
 }
 
 void LED::draw(bool highlighted) {
@@ -147,14 +163,20 @@ void LED::draw(bool highlighted) {
     _y += _gap;
 }
 
-void drawMenuTitle(const String& name) {
+void drawMenuTitle(const char* name) {
     centered_text(name, 12);
 }
 
 void refreshDisplay() {
+    if (current_scene) {
+        current_scene->frameDrawn();  // So that redrawIfChanged() skips this frame
+    }
+    profile_end(PROF_COMPOSE);
+    profile_begin(PROF_PUSH);
     display.startWrite();
     canvas.pushSprite(0, 0);
     display.endWrite();
+    profile_end(PROF_PUSH);
 }
 
 void drawMenuView(std::vector<String> labels, int start, int selected) {}
@@ -173,7 +195,7 @@ void showImageFile(const char* name, int x, int y, int width, int height) {
 }
 
 void showError() {
-    if ((milliseconds() - errorExpire) < 0) {
+    if (error_showing()) {
         canvas.fillCircle(120, 120, 95, RED);
         drawCircle(120, 120, 95, 5, WHITE);
         centered_text("Error", 95, WHITE, MEDIUM);
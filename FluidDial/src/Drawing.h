@@ -6,6 +6,7 @@
 #pragma once
 #include "FluidNCModel.h"
 #include "Text.h"
+#include "FrameHash.h"
 
 class Stripe {
 private:
@@ -23,8 +24,8 @@ private:
 
 public:
     Stripe(int x, int y, int width, int height, fontnum_t font);
-    void draw(const String& left, const String& right, bool highlighted, int left_color = WHITE);
-    void draw(const String& center, bool highlighted);
+    void draw(const char* left, const char* right, bool highlighted, int left_color = WHITE);
+    void draw(const char* center, bool highlighted);
     int  y() { return _y; }
     int  gap() { return _height + 1; }
 };
@@ -44,6 +45,8 @@ class DRO : public Stripe {
 public:
     DRO(int x, int y, int width, int height) : Stripe(x, y, width, height, MEDIUM_MONO) {}
     void draw(int axis, bool highlight);
+
+    static void hash(FrameHash& hash, int axis);
 };
 
 // draw stuff
@@ -54,6 +57,9 @@ void drawBackground(int color);
 void drawStatus();
 void drawStatusTiny(int y);
 
+// The model values shown by drawStatus(), drawStatusTiny() and showError()
+void hashStatus(FrameHash& hash);
+
 void drawFilledCircle(int x, int y, int radius, int fillcolor);
 void drawFilledCircle(Point xy, int radius, int fillcolor);
 
@@ -70,8 +76,8 @@ void drawRect(Point xy, Point wh, int radius, int bgcolor);
 void drawOutlinedRect(int x, int y, int width, int height, int bgcolor, int outlinecolor);
 void drawOutlinedRect(Point xy, int width, int height, int bgcolor, int outlinecolor);
 
-void drawButtonLegends(const String& red, const String& green, const String& orange);
-void drawMenuTitle(const String& name);
+void drawButtonLegends(const char* red, const char* green, const char* orange);
+void drawMenuTitle(const char* name);
 
 void drawPngFile(const String& filename, int x, int y);
 void drawPngFile(const String& filename, Point xy);
@@ -3,6 +3,44 @@
 #include "driver/pcnt.h"
 #include "driver/gpio.h"
 #include "Encoder.h"
+#include "EventLoop.h"
+#include "SPSCRing.h"
+
+// The PCNT unit does the counting, so no count is lost however late an
+// interrupt runs.  Reaching either limit resets the hardware counter to
+// zero and raises an interrupt that moves the 32-bit base by the limit;
+// the position is the base plus the hardware counter.  The limits are
+// thousands of detents apart, so that interrupt is rare.
+constexpr static const int16_t ENCODER_WRAP = 8000;
+
+// The glitch filter ignores pulses shorter than this many APB clocks
+// (80 MHz), which is the hardware maximum of 12.8 us
+constexpr static const uint16_t GLITCH_FILTER = 1023;
+
+static volatile int32_t        base = 0;  // Counts at the last wrap
+static SPSCRing<uint32_t, 64> edges;     // Times of pin changes, ISR -> UI
+
+// UI side
+static int32_t consumed = 0;
+
+static void encoder_wrap_isr(void* arg) {
+    uint32_t status;
+    pcnt_get_event_status(PCNT_UNIT_0, &status);
+    if (status & PCNT_EVT_H_LIM) {
+        base += ENCODER_WRAP;
+    }
+    if (status & PCNT_EVT_L_LIM) {
+        base -= ENCODER_WRAP;
+    }
+}
+
+// The pins interrupt on every change only to timestamp the motion.  If
+// this runs late, or the UI has fallen behind, a time is lost but the
+// count is still in the PCNT unit.
+static void encoder_edge_isr() {
+    edges.push(micros());
+    event_wake(EV_WAKE_ENCODER);
+}
 
 /* clang-format: off */
 void init_encoder() {
@@ -15,8 +53,8 @@ void init_encoder() {
         .pos_mode   = PCNT_COUNT_INC,     //Count Only On Rising-Edges
         .neg_mode   = PCNT_COUNT_DEC,     // Discard Falling-Edge
 
-        .counter_h_lim = INT16_MAX,
-        .counter_l_lim = INT16_MIN,
+        .counter_h_lim = ENCODER_WRAP,
+        .counter_l_lim = -ENCODER_WRAP,
 
         .unit    = PCNT_UNIT_0,
         .channel = PCNT_CHANNEL_0,
@@ -30,7 +68,7 @@ void init_encoder() {
     enc_config.neg_mode       = PCNT_COUNT_INC;  // Discard Rising-Edge
     pcnt_unit_config(&enc_config);
 
-    pcnt_set_filter_value(PCNT_UNIT_0, 250);  // Filter Runt Pulses
+    pcnt_set_filter_value(PCNT_UNIT_0, GLITCH_FILTER);  // Filter Runt Pulses
 
     pcnt_filter_enable(PCNT_UNIT_0);
 
@@ -40,10 +78,45 @@ void init_encoder() {
     pcnt_counter_pause(PCNT_UNIT_0);  // Initial PCNT init
     pcnt_counter_clear(PCNT_UNIT_0);
     pcnt_counter_resume(PCNT_UNIT_0);
+
+    pcnt_event_enable(PCNT_UNIT_0, PCNT_EVT_H_LIM);
+    pcnt_event_enable(PCNT_UNIT_0, PCNT_EVT_L_LIM);
+    pcnt_isr_service_install(0);
+    pcnt_isr_handler_add(PCNT_UNIT_0, encoder_wrap_isr, nullptr);
+
+    attachInterrupt(GPIO_NUM_40, encoder_edge_isr, CHANGE);
+    attachInterrupt(GPIO_NUM_41, encoder_edge_isr, CHANGE);
 }
 
-int16_t get_encoder() {
+int32_t encoder_position() {
+    // Read the base again in case it wrapped while the counter was read
+    int32_t at_wrap;
     int16_t count;
-    pcnt_get_counter_value(PCNT_UNIT_0, &count);
-    return count;
+    do {
+        at_wrap = base;
+        pcnt_get_counter_value(PCNT_UNIT_0, &count);
+    } while (at_wrap != base);
+    return at_wrap + count;
+}
+
+bool take_encoder_motion(encoder_motion& motion) {
+    uint32_t time_us;
+    bool     have_sample = false;
+    while (edges.pop(time_us)) {
+        if (!have_sample) {
+            motion.first_us = time_us;
+            have_sample     = true;
+        }
+        motion.last_us = time_us;
+    }
+    int32_t now_at = encoder_position();
+    motion.delta   = now_at - consumed;
+    consumed       = now_at;
+    if (!motion.delta) {
+        return false;
+    }
+    if (!have_sample) {
+        motion.first_us = motion.last_us = micros();
+    }
+    return true;
 }
@@ -2,5 +2,16 @@
 
 #include <Arduino.h>
 
-void    init_encoder();
-int16_t get_encoder();
+void init_encoder();
+
+// Encoder counts since boot.  32 bits, so it never wraps in practice.
+int32_t encoder_position();
+
+// Counts since the last call, with the times of the first and last
+// counts in that motion.  Returns false if the dial has not moved.
+struct encoder_motion {
+    int32_t  delta;
+    uint32_t first_us;
+    uint32_t last_us;
+};
+bool take_encoder_motion(encoder_motion& motion);
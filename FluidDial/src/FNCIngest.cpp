@@ -0,0 +1,180 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "FNCIngest.h"
+#include "SPSCRing.h"
+#include "System.h"
+#include "EventLoop.h"
+#include "JogLatency.h"
+#include "LinkHealth.h"
+#include <atomic>
+
+extern HardwareSerial Serial_FNC;
+
+// loop() runs on ARDUINO_RUNNING_CORE (1), so ingest goes on the other one
+constexpr static const int INGEST_CORE       = 0;
+constexpr static const int INGEST_PRIORITY   = 2;
+constexpr static const int INGEST_STACK_SIZE = 8192;
+
+constexpr static const int MAX_LINE_LEN = 128;
+
+struct outbound_line_t {
+    char     text[MAX_LINE_LEN];
+    int      timeout_ms;
+    uint32_t cancels;  // cancel_jogs() calls before it was queued
+};
+
+constexpr static const size_t EVENT_SLOTS = 32;
+constexpr static const size_t LINE_SLOTS  = 8;
+
+// Status reports and batches of listing or toolpath data leave this many
+// event slots free, so alarms, errors and the ends of streams find room
+constexpr static const size_t EVENT_RESERVE = 8;
+
+// Jog lines leave this many line slots free, so a fast MPG cannot crowd
+// out a command
+constexpr static const size_t JOG_RESERVE = 2;
+
+// Longest the ingest task waits for the UI to make room for an event.
+// At 115200 baud the 2K UART buffer fills in about 180 ms.
+constexpr static const int POST_WAIT_MS = 100;
+
+static SPSCRing<fnc_event_t, EVENT_SLOTS>    events;  // ingest -> UI
+static SPSCRing<outbound_line_t, LINE_SLOTS> lines;   // UI -> ingest
+
+static TaskHandle_t ingest_task = nullptr;
+
+// The line that an ok, error: or ack timeout is for
+static char unacked[MAX_LINE_LEN] = "";
+
+// Bumped by cancel_jogs(); jog lines queued before the last bump are dropped
+static std::atomic<uint32_t> jog_cancels(0);
+
+bool on_ingest_task() {
+    return ingest_task && xTaskGetCurrentTaskHandle() == ingest_task;
+}
+
+static bool is_bulk(fnc_event_type_t type) {
+    return type == EV_STATUS || type == EV_FILES_LIST || type == EV_TOOLPATH;
+}
+
+bool post_fnc_event(const fnc_event_t& event) {
+    bool room   = !is_bulk(event.type) || events.size() < EVENT_SLOTS - EVENT_RESERVE;
+    bool posted = room && events.push(event);
+    event_wake(EV_WAKE_UART);
+    return posted;
+}
+
+// The parser cannot be re-entered from the callback that posts, so the
+// UART is not read during the wait.  The UI never waits for this task,
+// so it makes room within a loop, but the wait is bounded in case it
+// has stalled, before the UART buffer can overflow.
+bool post_fnc_event_wait(const fnc_event_t& event) {
+    uint32_t start = millis();
+    while (!post_fnc_event(event)) {
+        if (millis() - start >= POST_WAIT_MS) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// fnc_send_line() reports an ack timeout for the previous line before
+// it sends this one
+static void send_line_now(const char* line, int timeout_ms) {
+    jog_latency_sent(line);
+    fnc_send_line(line, timeout_ms);
+    strncpy(unacked, line, MAX_LINE_LEN - 1);
+    unacked[MAX_LINE_LEN - 1] = '\0';
+}
+
+const char* unacked_line() {
+    return unacked;
+}
+
+void line_acked() {
+    unacked[0] = '\0';
+}
+
+bool get_fnc_event(fnc_event_t& event) {
+    return events.pop(event);
+}
+
+bool queue_line(const char* line, int timeout_ms) {
+    if (on_ingest_task()) {
+        // Sent from a parser callback, so there is no need to queue it
+        send_line_now(line, timeout_ms);
+        return true;
+    }
+    // Never wait for room.  The ingest task may be waiting for acks on
+    // earlier lines, or for the UI to take its events.
+    bool jog = strncmp(line, "$J=", 3) == 0;
+    if (lines.size() >= (jog ? LINE_SLOTS - JOG_RESERVE : LINE_SLOTS)) {
+        return false;
+    }
+    jog_latency_queued(line);
+    outbound_line_t out;
+    strncpy(out.text, line, MAX_LINE_LEN - 1);
+    out.text[MAX_LINE_LEN - 1] = '\0';
+    out.timeout_ms             = timeout_ms;
+    out.cancels                = jog_cancels.load(std::memory_order_acquire);
+    lines.push(out);  // This is the only producer, so there is still room
+    xTaskNotifyGive(ingest_task);
+    return true;
+}
+
+// Runs in the UART driver's event task when data arrives
+static void fnc_rx_notify() {
+    if (ingest_task) {
+        xTaskNotifyGive(ingest_task);
+    }
+}
+
+// Runs in the UART driver's event task when bytes were lost or damaged
+static void fnc_rx_error(hardwareSerial_error_t error) {
+    link_uart_error(error == UART_BUFFER_FULL_ERROR || error == UART_FIFO_OVF_ERROR);
+}
+
+// Called by GrblParserC after every character it handles, including
+// while fnc_send_line() waits for an ok.  When the UART is drained,
+// sleep until more data arrives, checking the ack timeout periodically.
+extern "C" void poll_extra() {
+    if (on_ingest_task() && !Serial_FNC.available()) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+}
+
+static void ingest_loop(void* arg) {
+    outbound_line_t out;
+    while (true) {
+        while (Serial_FNC.available()) {
+            fnc_poll();
+        }
+        while (lines.pop(out)) {
+            bool     jog     = strncmp(out.text, "$J=", 3) == 0;
+            uint32_t cancels = jog_cancels.load(std::memory_order_acquire);
+            if (jog && out.cancels != cancels) {
+                continue;  // Cancelled before it was sent
+            }
+            send_line_now(out.text, out.timeout_ms);
+            if (jog && jog_cancels.load(std::memory_order_acquire) != cancels) {
+                // The cancel may have reached FluidNC before this line did
+                fnc_realtime(JogCancel);
+            }
+        }
+        // Sleep until data arrives or a line is queued
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_WAKE_MS));
+    }
+}
+
+void cancel_jogs() {
+    jog_cancels.fetch_add(1, std::memory_order_release);
+    fnc_realtime(JogCancel);
+}
+
+void start_fnc_ingest() {
+    Serial_FNC.onReceive(fnc_rx_notify);
+    Serial_FNC.onReceiveError(fnc_rx_error);
+    xTaskCreatePinnedToCore(ingest_loop, "fnc_ingest", INGEST_STACK_SIZE, nullptr, INGEST_PRIORITY, &ingest_task, INGEST_CORE);
+}
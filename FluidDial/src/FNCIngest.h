@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// FluidNC ingest task.  The UART is read and parsed by GrblParserC on
+// the core that does not run loop(), so a slow redraw cannot delay parsing
+// and a long file listing cannot freeze the UI.  Parsed results reach the
+// UI through fnc_event_t's in a lock-free ring; outbound lines go the
+// other way through a second ring.  Realtime characters are written to
+// the UART directly from either side.
+
+#pragma once
+#include <Arduino.h>
+#include "GrblParserC.h"
+
+class FileList;
+class LineBlock;
+struct toolpath_batch;
+
+struct status_snapshot_t {
+    char               state[16];
+    bool               has_file;
+    file_percent_t     percent;
+    bool               has_linenum;
+    int                linenum;
+    bool               has_buffers;
+    int                planner_avail;
+    uint32_t           feedrate;
+    bool               has_overrides;
+    override_percent_t fro;
+    size_t             n_axis;
+    pos_t              axes[MAX_N_AXIS];  // Work coordinates
+    bool               limits[MAX_N_AXIS];
+    bool               probe;
+};
+
+enum fnc_event_type_t {
+    EV_STATUS,         // status
+    EV_ERROR,          // value
+    EV_ALARM,          // value
+    EV_GCODE_MODES,    // text
+    EV_FILES_START,    // no data
+    EV_FILES_LIST,     // files, a batch of entries; ownership passes to the UI
+    EV_FILES_END,      // no data
+    EV_FILES_FAILED,   // no data; a listing request failed, or the listing did not arrive whole
+    EV_FILE_LINES,     // lines, ownership passes to the UI
+    EV_FILES_CHANGED,  // no data
+    EV_TOOLPATH,       // toolpath, a batch of segments; ownership passes to the UI
+    EV_TOOLPATH_END,   // value, true if the pass has ended, else only the chunk
+};
+
+struct fnc_event_t {
+    fnc_event_type_t type;
+    union {
+        status_snapshot_t      status;
+        int                    value;
+        char                   text[64];
+        FileList*              files;
+        LineBlock*             lines;
+        toolpath_batch*        toolpath;
+    };
+};
+
+// Start the ingest task.  Serial_FNC must already be open.
+void start_fnc_ingest();
+
+// True when called from the ingest task
+bool on_ingest_task();
+
+// Ingest side: hand an event to the UI.  Returns false if the ring is
+// full.  Status reports and batches of entries, lines or segments may
+// not use the last few slots, which are kept for the other events.
+bool post_fnc_event(const fnc_event_t& event);
+
+// Ingest side: as post_fnc_event(), for an event that must not be lost,
+// but waits a short while for the UI to make room
+bool post_fnc_event_wait(const fnc_event_t& event);
+
+// UI side: take the next event, if any
+bool get_fnc_event(fnc_event_t& event);
+
+// UI side: queue a line for the ingest task to send with fnc_send_line().
+// Returns false, without waiting, if the queue is full; jog lines may
+// not use the last slots, so that other commands still get through.
+bool queue_line(const char* line, int timeout_ms);
+
+// Ingest side: the last line sent, until it is acknowledged or its
+// answer has been handled, else ""
+const char* unacked_line();
+void        line_acked();
+
+// UI side: send JogCancel, and drop the $J= lines still queued for the
+// ingest task so that they do not start the machine moving again
+void cancel_jogs();
@@ -0,0 +1,82 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "FileList.h"
+#include <algorithm>
+
+bool file_entry_less(int type1, const char* name1, int type2, const char* name2) {
+    if (type1 != type2) {
+        return type1 > type2;
+    }
+    return strcmp(name1, name2) < 0;
+}
+
+file_entry FileList::operator[](size_t i) const {
+    const record& r = _records[i];
+    return { &_names[r.offset], r.type, r.size };
+}
+
+void FileList::insert(size_t pos, const char* name, int type, int size) {
+    size_t length = std::min(strlen(name), MAX_FILE_NAME);
+
+    // Names of erased entries are left behind in the arena.  Squeeze
+    // them out before growing it.
+    if (_names.size() + length + 1 > _names.capacity() && _names.size() > 2 * _live_bytes) {
+        compact();
+    }
+    if (_names.size() + length + 1 > UINT16_MAX) {
+        return;  // Far more than any listing window holds
+    }
+
+    record r;
+    r.offset = _names.size();
+    r.length = length;
+    r.type   = type;
+    r.size   = size;
+    _names.insert(_names.end(), name, name + length);
+    _names.push_back('\0');
+    _live_bytes += length + 1;
+    _records.insert(_records.begin() + pos, r);
+}
+
+void FileList::erase(size_t pos) {
+    _live_bytes -= _records[pos].length + 1;
+    _records.erase(_records.begin() + pos);
+}
+
+void FileList::compact() {
+    std::vector<char> names;
+    names.reserve(_live_bytes);
+    for (auto& r : _records) {
+        const char* name = &_names[r.offset];
+        r.offset         = names.size();
+        names.insert(names.end(), name, name + r.length + 1);
+    }
+    _names.swap(names);
+}
+
+size_t FileList::upper_bound(int type, const char* name) const {
+    size_t lo = 0;
+    size_t hi = _records.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (file_entry_less(type, name, _records[mid].type, &_names[_records[mid].offset])) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void FileList::reserve(size_t n_entries, size_t name_bytes) {
+    _records.reserve(n_entries);
+    _names.reserve(name_bytes);
+}
+
+void FileList::clear() {
+    // Swapping with empty vectors returns the memory, unlike clear()
+    std::vector<char>().swap(_names);
+    std::vector<record>().swap(_records);
+    _live_bytes = 0;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Directory entries stored as one arena of names plus an array of small
+// fixed-size records, instead of one heap String per entry.  Sorting
+// and inserting move only the records, and clear() frees everything at
+// once.
+
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+// One entry.  fileName points into the arena of the list that holds it,
+// so it is only valid until that list is changed.
+struct file_entry {
+    const char* fileName;
+    int         fileType;  // 1 for a directory, 2 for a file
+    int         fileSize;
+};
+
+// Longer names are truncated
+constexpr static const size_t MAX_FILE_NAME = 255;
+
+// Files first, then directories, each in name order (same as the WebUI)
+bool file_entry_less(int type1, const char* name1, int type2, const char* name2);
+
+class FileList {
+private:
+    struct record {
+        uint16_t offset;  // Of the name in _names
+        uint8_t  length;
+        uint8_t  type;
+        int32_t  size;
+    };
+
+    std::vector<char>   _names;  // NUL-terminated names, end to end
+    std::vector<record> _records;
+    size_t              _live_bytes = 0;  // Bytes of _names still referenced
+
+    void compact();
+
+public:
+    size_t     size() const { return _records.size(); }
+    file_entry operator[](size_t i) const;
+
+    void insert(size_t pos, const char* name, int type, int size);
+    void push_back(const char* name, int type, int size) { insert(_records.size(), name, type, size); }
+    void push_back(const file_entry& e) { push_back(e.fileName, e.fileType, e.fileSize); }
+    void erase(size_t pos);
+
+    // Index of the first entry that sorts after (type, name)
+    size_t upper_bound(int type, const char* name) const;
+
+    void reserve(size_t n_entries, size_t name_bytes);
+    void clear();
+
+    // Bytes of heap held, for memory reports
+    size_t heap_bytes() const { return _names.capacity() + _records.capacity() * sizeof(record); }
+};
@@ -5,203 +5,737 @@
 
 #include "Scene.h"        // current_scene->reDisplay()
 #include "GrblParserC.h"  // send_line()
+#include "FNCIngest.h"    // post_fnc_event()
+#include "Format.h"       // CommandBuf
+#include "Profiler.h"     // profile_alloc_count()
+#include "JsonScanner.h"
+#include "Toolpath.h"  // toolpath_line()
 
-#include <JsonStreamingParser.h>
-#include <JsonListener.h>
+#include <algorithm>
+#include <atomic>
 
-fileinfo              fileInfo;
-std::vector<fileinfo> fileVector;
-
-JsonStreamingParser parser;
-
-// This is necessary because of an annoying "feature" of JsonStreamingParser.
-// After it issues an endDocument, it sets its internal state to STATE_DONE,
-// in which it ignores everything.  You cannot reset the parser in the endDocument
-// handler because it sets that state afterwards.  So we have to record the fact
-// that an endDocument has happened and do the reset later, when new data comes in.
-bool parser_needs_reset = true;
+fileinfo fileInfo;
 
 int    dirLevel = 0;
 String dirName("/sd");
 
 String current_filename;
 
-void enter_directory(const String& name) {
-    dirName += "/" + name;
+static bool entry_less(const file_entry& f1, const file_entry& f2) {
+    return file_entry_less(f1.fileType, f1.fileName, f2.fileType, f2.fileName);
+}
 
-    ++dirLevel;
-    request_file_list();
+
+// Which entries a listing keeps: the n_before entries that sort just
+// before the anchor, then the anchor and the entries after it, up to
+// FILE_WINDOW in all.
+struct list_request {
+    enum anchor_t { START, ENTRY, END };
+
+    anchor_t anchor_at;
+    fileinfo anchor;
+    int      n_before;
+    bool     move;  // Same directory, so keep showing the old window
+
+    bool before_anchor(const file_entry& f) const {
+        switch (anchor_at) {
+            case START:
+                return false;
+            case END:
+                return true;
+            default:
+                return file_entry_less(f.fileType, f.fileName, anchor.fileType, anchor.fileName.c_str());
+        }
+    }
+};
+
+class FileWindow {
+private:
+    FileList _before;      // Ascending
+    FileList _after;       // Ascending
+    int      _n_less = 0;  // All entries before the anchor
+
+    static void insert(FileList& list, const file_entry& f) {
+        list.insert(list.upper_bound(f.fileType, f.fileName), f.fileName, f.fileType, f.fileSize);
+    }
+
+public:
+    int  total    = 0;
+    bool complete = false;
+    int  select   = 0;  // Index to select when the window is shown
+
+    void release() {
+        _before.clear();
+        _after.clear();
+        _n_less  = 0;
+        total    = 0;
+        complete = false;
+        select   = 0;
+    }
+
+    int base() const { return _n_less - _before.size(); }
+    int size() const { return _before.size() + _after.size(); }
+    int anchor_index() const { return std::min(_n_less, total - 1); }
+
+    bool has(int index) const {
+        index -= base();
+        return index >= 0 && index < size();
+    }
+    file_entry at(int index) const {
+        index -= base();
+        return index < (int)_before.size() ? _before[index] : _after[index - _before.size()];
+    }
+
+    void add(const file_entry& f, const list_request& req) {
+        ++total;
+        if (req.before_anchor(f)) {
+            ++_n_less;
+            if ((int)_before.size() == req.n_before) {
+                if (!req.n_before || !entry_less(_before[0], f)) {
+                    return;  // Further from the anchor than everything kept
+                }
+                _before.erase(0);
+            }
+            insert(_before, f);
+        } else {
+            int room = FILE_WINDOW - req.n_before;
+            if ((int)_after.size() == room) {
+                if (!room || !entry_less(f, _after[room - 1])) {
+                    return;
+                }
+                _after.erase(room - 1);
+            }
+            insert(_after, f);
+        }
+    }
+
+    // Index of the entry, or -1 if it is not in the window
+    int find(const file_entry& f) const {
+        for (int i = base(); i < base() + size(); i++) {
+            file_entry e = at(i);
+            if (e.fileType == f.fileType && strcmp(e.fileName, f.fileName) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    size_t heap_bytes() const { return _before.heap_bytes() + _after.heap_bytes(); }
+};
+
+// UI side.  While the first listing of a directory streams in, it is
+// shown as it grows; a listing that moves the window is built in the
+// other FileWindow and shown when it is complete.
+static list_request request;
+static FileWindow   windows[2];
+static FileWindow*  shown         = &windows[0];
+static FileWindow*  building      = &windows[1];
+static int          pending_lists = 0;  // Listings requested but not yet ended
+
+static FileWindow* other_window(FileWindow* w) {
+    return w == &windows[0] ? &windows[1] : &windows[0];
 }
-void exit_directory() {
-    if (dirLevel) {
-        auto pos = dirName.lastIndexOf('/');
-        dirName  = dirName.substring(0, pos);
-        --dirLevel;
-        request_file_list();
+
+int file_count() {
+    return shown->total;
+}
+bool file_list_complete() {
+    return shown->complete;
+}
+bool file_list_moved() {
+    return request.move;
+}
+bool file_available(int index) {
+    return shown->has(index);
+}
+file_entry file_at(int index) {
+    return shown->at(index);
+}
+int file_anchor_index() {
+    return shown->complete ? shown->select : shown->anchor_index();
+}
+
+// Recently listed directories, so that going back to one does not list
+// it again over the UART.  Each holds the last window shown for that
+// directory.  "Files changed" from FluidNC empties the cache.
+constexpr static const int DIR_CACHE_SIZE = 4;
+
+struct cached_dir {
+    String     name;
+    FileWindow window;
+    uint32_t   last_used = 0;
+};
+
+static cached_dir dir_cache[DIR_CACHE_SIZE];
+static uint32_t   cache_clock = 0;
+
+static cached_dir* find_cached(const String& name) {
+    for (auto& c : dir_cache) {
+        if (c.last_used && c.name == name) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+static void cache_window() {
+    cached_dir* c = find_cached(dirName);
+    if (!c) {
+        // Replace the least recently used
+        c = &dir_cache[0];
+        for (auto& d : dir_cache) {
+            if (d.last_used < c->last_used) {
+                c = &d;
+            }
+        }
+        c->name = dirName;
     }
+    c->window    = *shown;
+    c->last_used = ++cache_clock;
 }
 
-static bool fileinfoCompare(const fileinfo& f1, const fileinfo& f2) {
-    // sort into filename order, with files first and folders second (same as on webUI)
-    if (f1.fileType > f2.fileType) {
-        return true;
+// Show the cached window for dirName, selecting the entry "select" if
+// it is given and in the window.  Returns false if it is not cached.
+static bool restore_window(const file_entry* select) {
+    if (pending_lists) {
+        return false;  // A listing on its way could replace it
     }
-    if (f1.fileType < f2.fileType) {
+    cached_dir* c = find_cached(dirName);
+    if (!c) {
         return false;
     }
-    if (f1.fileName.compareTo(f2.fileName) < 0) {
-        return true;
+    c->last_used = ++cache_clock;
+    *shown       = c->window;
+    building->release();
+
+    int index     = select ? shown->find(*select) : -1;
+    shown->select = index >= 0 ? index : shown->base();
+    request.move  = false;
+    current_scene->onFilesList();
+    return true;
+}
+
+static void invalidate_dir_cache() {
+    for (auto& c : dir_cache) {
+        c.name      = "";
+        c.last_used = 0;
+        c.window.release();
     }
-    return false;
 }
 
-std::vector<String> fileLines;
+static void list_directory(list_request::anchor_t anchor_at, const file_entry* anchor, int n_before, bool move) {
+    request.anchor_at = anchor_at;
+    if (anchor) {
+        request.anchor = *anchor;
+    }
+    request.n_before = n_before;
+    request.move     = move;
 
-class FilesListListener : public JsonListener {
-private:
-    bool   haveNewFile;
-    String current_key;
+    CommandBuf command("$Files/ListGCode=");
+    command.add(dirName.c_str());
+    if (send_line(command)) {
+        ++pending_lists;
+    }
+}
 
-public:
-    void whitespace(char c) override {}
+void file_list_need(int index) {
+    constexpr int margin = 4;  // More than the entries shown beside the selection
 
-    void startDocument() override {}
-    void startArray() override {
-        fileVector.clear();
-        haveNewFile = false;
+    if (pending_lists || !shown->complete) {
+        return;
     }
-    void startObject() override {}
-
-    void key(String key) override {
-        current_key = key;
-        if (current_key == "name") {
-            haveNewFile = true;  // gets reset in endObject()
+    int  start      = shown->base();
+    int  end        = start + shown->size();
+    bool near_start = start > 0 && index < start + margin;
+    bool near_end   = end < shown->total && index >= end - margin;
+    if (!near_start && !near_end) {
+        return;
+    }
+    if (!shown->has(index)) {
+        // Wrapped around from one end of the list to the other
+        if (index == 0) {
+            list_directory(list_request::START, nullptr, 0, true);
+        } else if (index == shown->total - 1) {
+            list_directory(list_request::END, nullptr, FILE_WINDOW, true);
         }
+        return;
     }
+    file_entry anchor = shown->at(index);
+    list_directory(list_request::ENTRY, &anchor, near_end ? FILE_WINDOW / 4 : FILE_WINDOW * 3 / 4, true);
+}
 
-    void value(String value) override {
-        if (current_key == "name") {
-            fileInfo.fileName = value;
-            return;
+void enter_directory(const String& name) {
+    dirName += "/" + name;
+
+    ++dirLevel;
+    if (!restore_window(nullptr)) {
+        request_file_list();
+    }
+}
+void exit_directory() {
+    if (dirLevel) {
+        // Anchor the parent's listing at the directory being left, so
+        // it is the one selected
+        auto       pos  = dirName.lastIndexOf('/');
+        String     name = dirName.substring(pos + 1);
+        file_entry child { name.c_str(), 1, 0 };
+        dirName = dirName.substring(0, pos);
+        --dirLevel;
+        if (!restore_window(&child)) {
+            list_directory(list_request::ENTRY, &child, FILE_WINDOW / 2, false);
         }
-        if (current_key == "size") {
-            fileInfo.fileSize = value.toInt();
-            if (fileInfo.fileSize < 0) {
-                fileInfo.fileType = 1;
-                // fileInfo.fileName = String("/" + fileInfo.fileName);
-            }
+    }
+}
+
+// The toolpath thumbnail streams the file in chunks through the same
+// JSON handler.  Only one request for lines is ever outstanding, so the
+// handler can tell from this where the lines it gets should go.
+static std::atomic<bool> lines_to_toolpath { false };
+
+constexpr static const char* SHOW_SOME = "$File/ShowSome=";
+
+// The first line asked for by the line being answered, or -1 if that is
+// not a request for lines
+static int requested_first() {
+    const char* line = unacked_line();
+    return strncmp(line, SHOW_SOME, strlen(SHOW_SOME)) == 0 ? atoi(line + strlen(SHOW_SOME)) : -1;
+}
 
-            if (fileInfo.fileSize > 0) {
-                fileInfo.fileType = 2;
+//#define DEBUG_FILE_LIST
+
+// The JSON handler runs on the ingest task.  It builds new lists that
+// are handed to the UI through accept_file_list() and accept_file_lines().
+// The documents it understands are
+//   {"files":[{"name":"a.nc","size":"123"},...],"path":"/sd"}
+//   {"file_lines":["G0 X0",...],"path":"/sd/a.nc"}
+class FileJsonHandler : public JsonScanner::Handler {
+private:
+    // Entries go to the UI in batches as they are parsed, so nothing
+    // on this side grows with the size of the directory
+    constexpr static const int BATCH_SIZE = 16;
+
+    enum section_t { NONE, FILES, FILE_LINES };
+    enum field_t { OTHER, NAME, SIZE };
+
+    section_t            _section   = NONE;
+    field_t              _field     = OTHER;
+    bool                 _have_name = false;
+    char                 _name[MAX_FILE_NAME + 1];
+    int                  _size      = 0;
+    FileList*            _batch     = nullptr;
+    LineBlock*           _newLines  = nullptr;
+    bool                 _toolpath  = false;  // The lines are for toolpath_line()
+    bool                 _lost      = false;  // A batch of the listing did not reach the UI
+
+    // Every part of the listing must reach the UI, so wait for room
+    bool post(fnc_event_type_t type, FileList* files = nullptr) {
+        fnc_event_t event;
+        event.type  = type;
+        event.files = files;
+        return post_fnc_event_wait(event);
+    }
+    void flush() {
+        if (_batch) {
+            if (!post(EV_FILES_LIST, _batch)) {
+                delete _batch;  // The UI has stalled, so the listing will end as failed
+                _lost = true;
             }
-            return;
+            _batch = nullptr;  // Now owned by the UI
         }
     }
-    void endArray() override { std::sort(fileVector.begin(), fileVector.end(), fileinfoCompare); }
 
-    void endObject() override {
-        if (haveNewFile) {
-            fileVector.push_back(fileInfo);
-            haveNewFile = false;
+    // Ends a fetch of preview lines, with nullptr if it failed.  The UI
+    // fetches nothing else until this arrives, so wait for room.
+    void post_lines(LineBlock* lines) {
+        fnc_event_t event;
+        event.type  = EV_FILE_LINES;
+        event.lines = lines;
+        if (!post_fnc_event_wait(event)) {
+            delete lines;
         }
+        line_acked();  // Answered, so a late error: or timeout is not for it
     }
 
-//#define DEBUG_FILE_LIST
-    void endDocument() override {
+    void add_entry() {
+        // Same typing as the WebUI: negative sizes are directories
+        int type = _size < 0 ? 1 : _size > 0 ? 2 : 0;
 #ifdef DEBUG_FILE_LIST
-        int ix = 0;
-        for (auto const& vi : fileVector) {
-            USBSerial.printf("[%d] type: %d:%s:\"%s\", size: %d\r\n",
-                             ix++,
-                             vi.fileType,
-                             (vi.fileType == 2) ? "file" : "dir ",
-                             vi.fileName.c_str(),
-                             vi.fileSize);
-        }
+        USBSerial.printf("type: %d:%s:\"%s\", size: %d\r\n", type, (type == 2) ? "file" : "dir ", _name, _size);
 #endif
-        init_listener();
-        current_scene->onFilesList();
+        if (!_batch) {
+            _batch = new FileList;
+            _batch->reserve(BATCH_SIZE, BATCH_SIZE * 24);
+        }
+        _batch->push_back(_name, type, _size);
+        if (_batch->size() == BATCH_SIZE) {
+            flush();
+        }
     }
-} filesListListener;
-
-class FileLinesListener : public JsonListener {
-private:
-    bool _in_array;
 
 public:
-    void whitespace(char c) override {}
+    void start(char type, int depth) override {
+        if (depth == 1) {
+            _section = NONE;
+            return;
+        }
+        if (depth == 2 && type == '[') {
+            if (_section == FILES) {
+                _lost = false;
+                post(EV_FILES_START);
+            } else if (_section == FILE_LINES) {
+                // Numbered from the request being answered, not from
+                // the UI's latest request, which may be a later one
+                int first = requested_first();
+                if (first < 0) {
+                    _section = NONE;  // Nobody asked
+                    return;
+                }
+                _toolpath = lines_to_toolpath;
+                if (_toolpath) {
+                    toolpath_begin_chunk(first);
+                } else {
+                    delete _newLines;
+                    _newLines = new LineBlock;
+                    _newLines->reserve(PREVIEW_BLOCK, PREVIEW_BLOCK * 32);
+                    _newLines->first = first;
+                }
+            }
+            return;
+        }
+        if (depth == 3 && _section == FILES) {
+            _have_name = false;
+            _size      = 0;
+        }
+    }
 
-    void startDocument() override {}
-    void startArray() override {
-        fileLines.clear();
-        _in_array = true;
+    void key(const char* key, int depth) override {
+        if (depth == 1) {
+            _section = strcmp(key, "files") == 0 ? FILES : strcmp(key, "file_lines") == 0 ? FILE_LINES : NONE;
+            return;
+        }
+        if (depth == 3) {
+            _field = strcmp(key, "name") == 0 ? NAME : strcmp(key, "size") == 0 ? SIZE : OTHER;
+        }
     }
-    void startObject() override {}
 
-    void key(String key) override {
-        //      if (key == "path") {}
+    void value(const char* value, bool quoted, int depth) override {
+        if (depth == 2 && _section == FILE_LINES) {
+            if (_toolpath) {
+                toolpath_line(value);
+            } else if (_newLines) {
+                _newLines->push_back(value);
+            }
+            return;
+        }
+        if (depth == 3 && _section == FILES) {
+            if (_field == NAME) {
+                strcpy(_name, value);  // The token is no longer than MAX_FILE_NAME
+                _have_name = true;
+            } else if (_field == SIZE) {
+                _size = atoi(value);  // Quoted or not
+            }
+        }
     }
 
-    void value(String value) override {
-        if (_in_array) {
-            fileLines.push_back(value);
+    void end(char type, int depth) override {
+        if (depth == 3 && _section == FILES && _have_name) {
+            add_entry();
+            return;
+        }
+        if (depth == 2 && _section == FILES) {
+            flush();
+            post(_lost ? EV_FILES_FAILED : EV_FILES_END);
+            _section = NONE;
         }
     }
 
-    void endArray() override { _in_array = false; }
-    void endObject() override {}
-    void endDocument() override {
-        init_listener();
-        current_scene->onFileLines();
+    void end_document() override {
+        if (_toolpath) {
+            toolpath_end_chunk(false);
+            _toolpath = false;
+            line_acked();  // Answered, so a late error: or timeout is not for it
+        }
+        if (_newLines) {
+            post_lines(_newLines);
+            _newLines = nullptr;
+        }
+        _section = NONE;
     }
-} fileLinesListener;
 
-class InitialListener : public JsonListener {
-private:
-public:
-    void whitespace(char c) override {}
-    void startDocument() override {}
-    void value(String value) override {}
-    void endArray() override {}
-    void endObject() override {}
-    void endDocument() override {}
-    void startArray() override {}
-    void startObject() override {}
-
-    void key(String key) override {
-        if (key == "files") {
-            parser.setListener(&filesListListener);
-            return;
+    // FluidNC answered a line with error:, or did not acknowledge it.  A
+    // listing that never started will not end, so tell the UI; one that
+    // is arriving ends as usual.  A request for lines that was answered
+    // is no longer unacked, so it does not get here.
+    void command_failed(const char* line) {
+        if (strncmp(line, "$Files/ListGCode=", strlen("$Files/ListGCode=")) == 0 && _section != FILES) {
+            post(EV_FILES_FAILED);
         }
-        if (key == "file_lines") {
-            parser.setListener(&fileLinesListener);
-            return;
+        if (strncmp(line, SHOW_SOME, strlen(SHOW_SOME)) == 0) {
+            if (lines_to_toolpath) {
+                toolpath_end_chunk(true);
+            } else {
+                post_lines(nullptr);
+            }
+        }
+    }
+
+    void error() override {
+        log_println("Bad JSON from FluidNC");
+        // End a listing so that the UI is not left waiting for it, but
+        // as failed, so the entries before the error are not cached
+        if (_section == FILES) {
+            flush();
+            post(EV_FILES_FAILED);
+        }
+        if (_toolpath) {
+            toolpath_end_chunk(true);
+            _toolpath = false;
         }
+        if (_newLines) {
+            delete _newLines;
+            _newLines = nullptr;
+            post_lines(nullptr);
+        }
+        _section = NONE;
     }
-} initialListener;
+} fileJsonHandler;
+
+static_assert(JsonScanner::MAX_TOKEN == MAX_FILE_NAME, "File names are copied from scanner tokens");
+
+static JsonScanner scanner(fileJsonHandler);
+
+void file_command_failed(const char* line) {
+    fileJsonHandler.command_failed(line);
+}
 
 void init_listener() {
-    parser.setListener(&initialListener);
-    parser_needs_reset = true;
+    scanner.reset();
 }
 
 void request_file_list() {
-    String command("$Files/ListGCode=");
-    command += dirName;
-    send_line(command.c_str());
+    list_directory(list_request::START, nullptr, 0, false);
 }
 
+// Also used by the Refresh button, so it always lists the directory
 void init_file_list() {
-    dirLevel = 0;
-    dirName  = "/sd";
+    dirLevel      = 0;
+    dirName       = "/sd";
+    pending_lists = 0;  // Recovers if a listing never ended
     request_file_list();
 }
 
-void request_file_preview(const char* name) {
-    current_filename = dirName + "/" + name;
-    String command("$File/ShowSome=7,");
-    command += current_filename;
-    send_line(command.c_str());
+// Heap cost of the listing in progress, reported when it ends
+static uint32_t list_start_allocs;
+static uint32_t list_low_heap;
+static bool     list_started = false;  // Entries are arriving
+
+void accept_file_list_start() {
+    list_started      = true;
+    list_start_allocs = profile_alloc_count();
+    list_low_heap     = ESP.getFreeHeap();
+
+    building->release();
+    if (!request.move) {
+        // A new directory, so show it as it arrives
+        other_window(building)->release();
+        shown = building;
+    }
+}
+
+void accept_file_list(FileList* files) {
+    list_low_heap = std::min(list_low_heap, ESP.getFreeHeap());
+    for (size_t i = 0; i < files->size(); i++) {
+        building->add((*files)[i], request);
+    }
+    delete files;
+    if (shown == building) {
+        current_scene->onFilesList();
+    }
+}
+
+// Shows the window that was built.  Only a whole listing is cached.
+static void finish_listing(bool whole) {
+    list_started = false;
+    if (pending_lists) {
+        --pending_lists;
+    }
+    building->complete = true;
+    building->select   = building->anchor_index();
+    shown              = building;
+    building           = other_window(shown);
+    building->release();
+
+    char buf[100];
+    snprintf(buf,
+             sizeof(buf),
+             "Listed %d entries: %u allocs, heap low %u, window %u bytes",
+             shown->total,
+             profile_alloc_count() - list_start_allocs,
+             list_low_heap,
+             shown->heap_bytes());
+    log_println(buf);
+
+    // An older listing ending after a newer request might not be for dirName
+    if (whole && !pending_lists) {
+        cache_window();
+    }
+    current_scene->onFilesList();
+}
+
+void accept_file_list_end() {
+    finish_listing(true);
+}
+
+void accept_file_list_failed() {
+    if (list_started) {
+        // Show what arrived, but list the directory again next time
+        log_println("Listing incomplete");
+        finish_listing(false);
+        return;
+    }
+    if (pending_lists) {
+        --pending_lists;
+    }
+    building->release();
+    current_scene->onFilesList();
+}
+
+// Preview lines of current_filename.  A fetch is outstanding until its
+// lines, an error: or an ack timeout come back, and only one is ever
+// outstanding, so an answer cannot be taken for a later request.
+constexpr static const uint32_t FETCH_RETRY_MS = 2000;  // After a fetch that failed
+
+// FluidNC reads a file from its start to find the first line of a
+// chunk, so the ack timeout for a toolpath chunk grows with that line
+constexpr static const int CHUNK_TIMEOUT_MS  = 5000;
+constexpr static const int SKIP_LINES_PER_MS = 20;
+
+static LineCache preview_cache;
+static int       preview_total = -1;  // Lines in the file, once known
+static int       fetch_first   = -1;     // First line of the block being fetched
+static bool      fetch_stale   = false;  // It is for a file no longer previewed
+static bool      fetch_failed  = false;
+static uint32_t  fail_time;
+
+void preview_file(const char* name) {
+    String path = dirName + "/" + name;
+    if (path == current_filename) {
+        return;  // Still cached from last time
+    }
+    current_filename = path;
+    preview_cache.clear();
+    preview_total = -1;
+    fetch_stale   = fetch_first >= 0;
+    fetch_failed  = false;
+}
+
+static void clear_preview() {
+    current_filename = "";
+    preview_cache.clear();
+    preview_total = -1;
+    fetch_stale   = fetch_first >= 0;
+    fetch_failed  = false;
+}
+
+const char* preview_line(int n) {
+    auto block = preview_cache.find(n);
+    return block ? (*block)[n - block->first] : nullptr;
+}
+
+int preview_line_count() {
+    return preview_total;
+}
+
+// Asks for the block if it is in the file and not cached
+static bool fetch_block(int block) {
+    int first = block * PREVIEW_BLOCK;
+    if (block < 0 || (preview_total >= 0 && first >= preview_total) || preview_cache.find(first)) {
+        return false;
+    }
+    // FluidNC counts lines from 0 and stops before the second number
+    CommandBuf command(SHOW_SOME);
+    command.addInt(first).add(':').addInt(first + PREVIEW_BLOCK).add(',').add(current_filename.c_str());
+    if (!send_line(command)) {
+        return true;  // The link is busy, so try again later
+    }
+    fetch_first = first;
+    return true;
+}
+
+bool file_lines_idle() {
+    return !lines_to_toolpath && fetch_first < 0;
+}
+
+bool request_toolpath_lines(int first) {
+    CommandBuf command(SHOW_SOME);
+    command.addInt(first).add(':').addInt(first + TOOLPATH_CHUNK).add(',').add(current_filename.c_str());
+    lines_to_toolpath = true;  // Before the answer can arrive
+    if (!send_line(command, CHUNK_TIMEOUT_MS + first / SKIP_LINES_PER_MS)) {
+        lines_to_toolpath = false;
+        return false;
+    }
+    fetch_first = -1;
+    return true;
+}
+
+void toolpath_stream_done() {
+    lines_to_toolpath = false;
+}
+
+void preview_need(int first, int n) {
+    if (current_filename.length() == 0 || !file_lines_idle()) {
+        return;
+    }
+    if (fetch_failed && (millis() - fail_time) < FETCH_RETRY_MS) {
+        return;
+    }
+
+    // The lines shown, then the block after them, then the one before,
+    // so scrolling either way finds the next lines already there
+    int start = first / PREVIEW_BLOCK;
+    int end   = (first + n - 1) / PREVIEW_BLOCK;
+    for (int block = start; block <= end; block++) {
+        if (fetch_block(block)) {
+            return;
+        }
+    }
+    if (!fetch_block(end + 1)) {
+        fetch_block(start - 1);
+    }
+}
+
+void accept_file_lines(LineBlock* lines) {
+    int  first  = fetch_first;
+    bool stale  = fetch_stale;
+    fetch_first = -1;
+    fetch_stale = false;
+    if (!lines) {
+        fetch_failed = true;
+        fail_time    = millis();
+        current_scene->onFileLines();  // The toolpath may be waiting for the link
+        return;
+    }
+    fetch_failed = false;
+    if (stale || lines->first != first) {
+        delete lines;  // For another file, or nobody asked
+        current_scene->onFileLines();
+        return;
+    }
+    if (lines->size() < PREVIEW_BLOCK) {
+        preview_total = lines->first + lines->size();
+    }
+    if (lines->size()) {
+        preview_cache.insert(lines);
+    } else {
+        delete lines;
+    }
+    current_scene->onFileLines();
+}
+
+void accept_files_changed() {
+    invalidate_dir_cache();
+    clear_preview();
+    init_file_list();
 }
 extern "C" void handle_msg(char* command, char* arguments) {
     if (strcmp(command, "RST") == 0) {
@@ -209,16 +743,14 @@ extern "C" void handle_msg(char* command, char* arguments) {
     }
     if (strcmp(command, "Files changed") == 0) {
         log_println("Files changed");
-        init_file_list();
+        // dirName belongs to the UI, so let it restart the listing
+        fnc_event_t event;
+        event.type = EV_FILES_CHANGED;
+        post_fnc_event(event);
     }
     if (strcmp(command, "JSON") == 0) {
-        if (parser_needs_reset) {
-            parser.reset();
-            parser_needs_reset = false;
-        }
-        while (*arguments) {
-            parser.parse(*arguments++);
-        }
+        // A document can span any number of these messages
+        scanner.parse(arguments);
 #define Ack 0xB2
         fnc_realtime((realtime_cmd_t)Ack);
     }
@@ -3,33 +3,82 @@
 
 #include <Arduino.h>
 #include <vector>
+#include "FileList.h"
+#include "LineCache.h"
 
 typedef void (*callback_t)(void*);
 
+// A copy of one entry that outlives the list it came from
 struct fileinfo {
     // String fileSys;
     // String filePath;
     String fileName;
     int    fileType;
     int    fileSize;
+
+    fileinfo& operator=(const file_entry& e) {
+        fileName = e.fileName;
+        fileType = e.fileType;
+        fileSize = e.fileSize;
+        return *this;
+    }
 };
 
 extern String dirName;
 extern int    dirLevel;
 
-extern fileinfo              fileInfo;
-extern std::vector<fileinfo> fileVector;
+extern fileinfo fileInfo;
+
+// Directories can hold far more entries than there is RAM for, so the
+// UI keeps only a window of up to FILE_WINDOW sorted entries.  Each
+// listing of the directory keeps the entries just before and after an
+// anchor entry; scrolling near the edge of the window relists the
+// directory around the selection.  Indices are positions in the whole
+// sorted directory.
+constexpr static const int FILE_WINDOW = 48;
+
+int             file_count();                 // Entries so far while listing
+bool            file_list_complete();         // The directory has been listed
+bool            file_list_moved();            // The last listing moved the window
+bool            file_available(int index);    // The entry is in the window
+file_entry      file_at(int index);           // Requires file_available(index)
+int             file_anchor_index();          // The entry to select in a new listing
+void            file_list_need(int index);    // Relist if index is near the edge
 
 extern void request_file_list();
 
-extern std::vector<String> fileLines;
+// A previewed file is fetched PREVIEW_BLOCK lines at a time around the
+// lines being shown, and the most recently used blocks are kept, so
+// only the part of a large file that is looked at is ever read.
+// Lines are numbered from 0.
+constexpr static const int PREVIEW_BLOCK = 16;
 
-extern void request_file_preview(const char* name);
+void        preview_file(const char* name);  // Keeps the cache if it is the same file
+const char* preview_line(int n);             // nullptr if not fetched
+int         preview_line_count();            // -1 until the end has been seen
+void        preview_need(int first, int n);  // Fetch the next block missing near these lines
+
+// For the toolpath thumbnail, which streams the file a chunk at a time
+bool file_lines_idle();                   // No request for lines is outstanding
+bool request_toolpath_lines(int first);  // TOOLPATH_CHUNK lines; false if the link is busy
+void toolpath_stream_done();
 
 extern String current_filename;
 
 void init_listener();
+
+// Ingest side: FluidNC answered this line with error: or did not ack it
+void file_command_failed(const char* line);
 void init_file_list();
 
+// Called on the UI side with data parsed by the ingest task.  Listings
+// arrive as a start, batches of entries, and an end.
+void accept_file_list_start();
+void accept_file_list(FileList* files);
+void accept_file_list_end();
+void accept_file_list_failed();  // The request was rejected, or the listing did not arrive whole
+void accept_file_lines(LineBlock* lines);
+void accept_files_changed();
+
 void enter_directory(const String& dirname);
 void exit_directory();
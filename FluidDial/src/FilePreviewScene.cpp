@@ -4,26 +4,68 @@
 #include <Arduino.h>
 #include "Scene.h"
 #include "FileParser.h"
+#include "Format.h"
+#include "Toolpath.h"
+#include "JobEstimate.h"
 
 extern Scene menuScene;
 
 class FilePreviewScene : public Scene {
-    String _filename;
-    bool   _needlines;
+    constexpr static const int N_SHOWN = 7;  // Lines on the screen
+
+    int  _top       = 0;      // First line shown
+    bool _show_path = false;  // The toolpath instead of the lines
 
 public:
-    FilePreviewScene() : Scene("Preview") {}
+    FilePreviewScene() : Scene("Preview") { setEncoderAcceleration(8); }
     void onEntry(void* arg) {
         char* fname = (char*)arg;
-        _filename   = fname;
-        _needlines  = true;
-        request_file_preview(fname);
+        preview_file(fname);
+        _top       = 0;
+        _show_path = false;
     }
+    void onExit() override { toolpath_close(); }
+
     void onFileLines() {
-        _needlines = false;
+        if (_show_path) {
+            toolpath_poll();  // It may have been waiting for these
+        } else {
+            reDisplay();
+        }
+    }
+    void onToolpath() override {
+        if (_show_path) {
+            reDisplay();
+        }
+    }
+
+    // Touch switches between the lines and the toolpath
+    void onTouchRelease(int x, int y) override {
+        _show_path = !_show_path;
+        if (_show_path) {
+            toolpath_open();
+        } else {
+            toolpath_close();
+        }
         reDisplay();
     }
 
+    void onEncoder(int delta) override {
+        if (_show_path) {
+            return;
+        }
+        int top   = _top + delta;
+        int count = preview_line_count();
+        if (count >= 0) {
+            top = std::min(top, count - N_SHOWN);
+        }
+        top = std::max(top, 0);
+        if (top != _top) {
+            _top = top;
+            reDisplay();
+        }
+    }
+
     void onDialButtonPress() { activate_scene(&menuScene); }
 
     void onRedButtonPress() {
@@ -33,37 +75,57 @@ public:
         }
     }
 
-    void onDROChange() { reDisplay(); }
+    void onDROChange() { redrawIfChanged(); }
+
+    void hashInputs(FrameHash& hash) override { hashStatus(hash); }
 
     void onGreenButtonPress() {
         if (state == Idle) {
-            String command = "$SD/Run=" + dirName + "/" + fileInfo.fileName;
-            send_line(command.c_str());
+            CommandBuf command("$SD/Run=");
+            command.add(dirName.c_str()).add('/').add(fileInfo.fileName.c_str());
+            send_line(command);
+            estimate_start_job();
             ackBeep();
         }
     }
     void reDisplay() {
-        String grnText, redText = "";
+        const char* grnText = "";
+        const char* redText = "";
 
-        canvas.createSprite(240, 240);
         drawBackground(BLACK);
+        if (_show_path && !toolpath_draw()) {
+            text(toolpath_status(), 120, 120, WHITE, TINY, middle_center);
+        }
         drawMenuTitle(name());
         drawStatusTiny(20);
 
-        if (state == Idle) {
-            if (_needlines == false) {
-                int y  = 39;
-                int tl = 0;
-                if (fileLines.size()) {
-                    for (auto const& line : fileLines) {
-                        text(line, 25, y + tl * 22, WHITE, TINY, top_left);
-                        ++tl;
-                    }
-                } else {
+        if (state == Idle && _show_path) {
+            // Start the next pass if it was waiting for the preview lines
+            toolpath_poll();
+            if (estimate_ready()) {
+                StackBuf<24> estimate("Time ");
+                estimate.addTime(estimate_total());
+                centered_text(estimate, 190, WHITE, TINY);
+            }
+            grnText = "Run";
+            redText = "Back";
+        } else if (state == Idle) {
+            // Drawn from the cache; missing lines show up when they arrive
+            preview_need(_top, N_SHOWN);
+            bool any = false;
+            for (int i = 0; i < N_SHOWN; i++) {
+                const char* line = preview_line(_top + i);
+                if (line) {
+                    text(line, 25, 39 + i * 22, WHITE, TINY, top_left);
+                    any = true;
+                }
+            }
+            if (!any) {
+                if (preview_line_count() == 0) {
                     text("No Text", 120, 120, WHITE, SMALL, middle_center);
+                } else {
+                    text("Reading File", 120, 120, WHITE, TINY, middle_center);
                 }
-            } else {
-                text("Reading File", 120, 120, WHITE, TINY, middle_center);
             }
             grnText = "Run";
             redText = "Back";
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
 #include "FileParser.h"
 
 // #define SMOOTH_SCROLL
@@ -13,22 +14,16 @@
 #else
 #define DBG_WRAP_FILES(...)
 #endif
-
-#if 0
-#define DBG_PREV_SELECT(...) log_printf(__VA_ARGS__)
-#else
-#define DBG_PREV_SELECT(...)
-#endif
 // clang-format on
 
 extern Scene filePreviewScene;
 
-String displayTitle = "Files";
+const char* displayTitle = "Files";
 
 class FileSelectScene : public Scene {
 private:
-    int              _selected_file = 0;
-    std::vector<int> prevSelect;
+    int _selected_file = 0;
+    int _pending_select = -1;  // Waiting for the window to reach it
 
     const char* format_size(size_t size) {
         const int   buflen = 30;
@@ -48,15 +43,7 @@ private:
     }
 
 public:
-    FileSelectScene() : Scene("Files", 4) {}
-
-    void onEntry(void* arg) {
-        // a first time only thing, because files are already loaded
-        if (prevSelect.size() == 0) {
-            prevSelect.push_back(0);
-        }
-        DBG_PREV_SELECT("prevSelect::init:  size:%d, select:%d\r\n", prevSelect.size(), (prevSelect.size()) ? prevSelect.back() : 0);
-    }
+    FileSelectScene() : Scene("Files", 4) { setEncoderAcceleration(16); }
 
     void onDialButtonPress() { pop_scene(); }
 
@@ -65,15 +52,10 @@ public:
         if (state != Idle) {
             return;
         }
-        if (fileVector.size()) {
-            String dName;
-            fileInfo                                 = fileVector[_selected_file];
-            prevSelect[(int)(prevSelect.size() - 1)] = _selected_file;
+        if (file_available(_selected_file)) {
+            fileInfo = file_at(_selected_file);
             switch (fileInfo.fileType) {
                 case 1:  //directory
-                    prevSelect.push_back(0);
-                    DBG_PREV_SELECT(
-                        "prevSelect::push: size:%d, select:%d\r\n", prevSelect.size(), (prevSelect.size()) ? prevSelect.back() : 0);
                     enter_directory(fileInfo.fileName);
                     break;
                 case 2:  // file
@@ -90,12 +72,8 @@ public:
             return;
         }
         if (dirLevel) {
-            prevSelect.pop_back();
-            DBG_PREV_SELECT("prevSelect::pop:  size:%d, select:%d\r\n", prevSelect.size(), (prevSelect.size()) ? prevSelect.back() : 0);
             exit_directory();
         } else {
-            prevSelect.clear();
-            prevSelect.push_back(0);
             init_file_list();
         }
         ackBeep();
@@ -104,8 +82,13 @@ public:
     void onTouchRelease(int x, int y) { onGreenButtonPress(); }
 
     void onFilesList() override {
-        DBG_PREV_SELECT("prevSelect::back:  size:%d, select:%d\r\n", prevSelect.size(), (prevSelect.size()) ? prevSelect.back() : 0);
-        _selected_file = prevSelect.back();
+        if (!file_list_moved()) {
+            // A new directory listing, anchored at the entry to select
+            _selected_file = std::max(file_anchor_index(), 0);
+        } else if (_pending_select >= 0 && file_available(_pending_select)) {
+            _selected_file = _pending_select;
+        }
+        _pending_select = -1;
         reDisplay();
     }
 
@@ -117,12 +100,13 @@ public:
     }
 
     void buttonLegends() {
-        String grnText, redText = "";
+        const char* grnText = "";
+        const char* redText = "";
 
         if (state == Idle) {
             redText = dirLevel ? "Up..." : "Refresh";
-            if (fileVector.size()) {
-                switch (fileVector[_selected_file].fileType) {
+            if (file_available(_selected_file)) {
+                switch (file_at(_selected_file).fileType) {
                     case 0:
                         break;
                     case 1:
@@ -160,13 +144,13 @@ public:
     int box_fi[3] = { 1, 3, 5 };
 
     void showFiles(int yo) {
-        canvas.createSprite(240, 240);
         drawBackground(BLACK);
         displayTitle = current_scene->name();
         drawStatusTiny(20);
         drawMenuTitle(displayTitle);
-        String fName;
-        int    finfoT_color = BLUE;
+        StackBuf<80> fName;
+        int          finfoT_color = BLUE;
+        int          n_files      = file_count();
 
         int fdIter = _selected_file - 1;  // first file in display list
 
@@ -175,11 +159,11 @@ public:
             auto middle = box[fi];
 
 #ifdef WRAP_FILE_LIST
-            if (fileVector.size() > 2) {
+            if (n_files > 2) {
                 if (fdIter < 0) {
                     // last file first in list
-                    fdIter = fileVector.size() - 1;
-                } else if (fdIter > fileVector.size() - 1) {
+                    fdIter = n_files - 1;
+                } else if (fdIter > n_files - 1) {
                     // first file last in list
                     fdIter = 0;
                 }
@@ -192,21 +176,26 @@ public:
                 continue;
             }
 
-            fName = "< no files >";
-            if (fileVector.size()) {
-                fName = fileVector[fdIter].fileName;
+            fName.clear();
+            if (file_available(fdIter)) {
+                fName.add(file_at(fdIter).fileName);
+            } else if (n_files) {
+                fName.add("...");  // Outside the window
+            } else {
+                fName.add(file_list_complete() ? "< no files >" : "Loading...");
             }
             if (yo == 0 && middle._bg != BLACK) {
                 canvas.fillRoundRect(middle._xb, yo + middle._yb, middle._w, middle._h, middle._h / 2, middle._bg);
             }
             int middle_txt = middle._txt;
             if (fx == 1) {
-                String fInfoT = "";  // file info top line
-                String fInfoB = "";  // File info bottom line
-                int    ext    = fName.lastIndexOf('.');
-                float  fs     = 0.0;
-                if (fileVector.size()) {
-                    switch (fileVector[_selected_file].fileType) {
+                StackBuf<24> fInfoT;       // file info top line
+                const char*  fInfoB = "";  // File info bottom line
+                const char*  dot    = strrchr(fName, '.');
+                int          ext    = dot ? dot - fName.c_str() : -1;
+                float        fs     = 0.0;
+                if (file_available(_selected_file)) {
+                    switch (file_at(_selected_file).fileType) {
                         case 0:
                             break;
                         case 1:
@@ -215,24 +204,23 @@ public:
                             break;
                         case 2:
                             if (ext > 0) {
-                                fInfoT = fName.substring(ext, fName.length());
-                                fInfoT += " file";
-                                fName.remove(ext);
+                                fInfoT.add(dot).add(" file");
+                                fName.truncate(ext);
                             }
-                            fInfoB = format_size(fileVector[_selected_file].fileSize);
+                            fInfoB = format_size(file_at(_selected_file).fileSize);
                             break;
                     }
                 }
 
                 // progressbar
-                if (yo == 0 && (fileVector.size() > 3)) {  // three or less are all displayed
+                if (yo == 0 && (n_files > 3)) {  // three or less are all displayed
                     for (int i = 0; i < 6; i++) {
                         canvas.drawArc(120, 120, 118 - i, 115 - i, -50, 50, DARKGREY);
                     }
 
                     float mx  = 1.745;
                     float s   = mx / -2.0;
-                    float inc = mx / (float)(fileVector.size() - 1);
+                    float inc = mx / (float)(n_files - 1);
 
                     int x = cosf(s + inc * (float)_selected_file) * 114.0;
                     int y = sinf(s + inc * (float)_selected_file) * 114.0;
@@ -256,11 +244,11 @@ public:
             }
             if (fx == 1) {
 #ifdef WRAP_FILE_LIST
-                if (fileVector.size() > 2) {
+                if (n_files > 2) {
                     continue;
                 }
 #endif
-                if (fdIter >= (int)(fileVector.size() - 1)) {
+                if (fdIter >= n_files - 1) {
                     break;
                 }
             }
@@ -271,23 +259,37 @@ public:
 
     void scroll(int updown) {
         int nextSelect = _selected_file + updown;
+        int n_files    = file_count();
 #ifdef WRAP_FILE_LIST
-        if (fileVector.size() < 3) {
-            if (nextSelect < 0 || nextSelect > (int)(fileVector.size() - 1)) {
+        if (n_files < 3) {
+            if (nextSelect < 0 || nextSelect > n_files - 1) {
                 return;
             }
         } else {
             if (nextSelect < 0) {
-                nextSelect = fileVector.size() - 1;
-            } else if (nextSelect > (int)(fileVector.size() - 1)) {
+                nextSelect = n_files - 1;
+            } else if (nextSelect > n_files - 1) {
                 nextSelect = 0;
             }
         }
 #else
-        if (nextSelect < 0 || nextSelect > (int)(fileVector.size() - 1)) {
+        if (abs(updown) == 1 && (nextSelect < 0 || nextSelect > n_files - 1)) {
             return;
         }
 #endif
+        // An accelerated step stops at the ends of the list
+        if (abs(updown) > 1) {
+            nextSelect = std::max(0, std::min(nextSelect, n_files - 1));
+            if (nextSelect == _selected_file) {
+                return;
+            }
+        }
+        if (!file_available(nextSelect)) {
+            // Move there when the relisted window arrives
+            file_list_need(nextSelect);
+            _pending_select = nextSelect;
+            return;
+        }
 
         const int yinc   = updown * 10;
         const int ylimit = 60;
@@ -301,9 +303,8 @@ public:
         }
 #endif
         _selected_file = nextSelect;
+        file_list_need(_selected_file);
         showFiles(0);
-
-        DBG_PREV_SELECT("scroll(%d): _selected_file:%2d, files:%2d\r\n", updown, _selected_file, fileVector.size());
     }
 
     void reDisplay() { showFiles(0); }
@@ -3,8 +3,16 @@
 
 #include "FluidNCModel.h"
 #include <map>
+#include <atomic>
 #include "System.h"
 #include "Scene.h"
+#include "FileParser.h"
+#include "FNCIngest.h"
+#include "Toolpath.h"
+#include "JobEstimate.h"
+#include "JogLatency.h"
+#include "MachineState.h"
+#include "LinkHealth.h"
 
 // local copies of status items
 String             stateString        = "N/C";
@@ -14,6 +22,9 @@ bool               myLimitSwitches[6] = { false };
 bool               myProbeSwitch      = false;
 String             myFile             = "";   // running SD filename
 file_percent_t     myPercent          = 0.0;  // percent conplete of SD file
+int                myLinenum          = 0;    // line of the SD file being run, if reported
+int                myPlannerAvail     = -1;   // free planner blocks, if reported
+uint32_t           myFeedrate         = 0;    // actual feed rate, mm/min
 override_percent_t myFro              = 100;  // Feed rate override
 int                lastAlarm          = 0;
 int                lastError          = 0;
@@ -76,117 +87,236 @@ String decode_error_number(int error_num) {
     return String(error_num);
 }
 
+// The parser callbacks below run on the ingest task.  They collect
+// a status report into a snapshot and post it, and the UI applies it
+// in dispatch_fnc_events(), so the model variables have only one writer.
+static fnc_event_t status_event;
+
 extern "C" void begin_status_report() {
-    myPercent = 0;
+    status_event.type = EV_STATUS;
+    memset(&status_event.status, 0, sizeof(status_event.status));
+}
+
+extern "C" void show_state(const char* state_string) {
+    strncpy(status_event.status.state, state_string, sizeof(status_event.status.state) - 1);
 }
 
 extern "C" void show_file(const char* filename, file_percent_t percent) {
-    myPercent = percent;
+    status_event.status.has_file = true;
+    status_event.status.percent  = percent;
+}
+
+extern "C" void show_linenum(int linenum) {
+    status_event.status.has_linenum = true;
+    status_event.status.linenum     = linenum;
+}
+
+extern "C" void show_buffers(uint32_t planner_avail, uint32_t rx_avail) {
+    status_event.status.has_buffers   = true;
+    status_event.status.planner_avail = planner_avail;
+}
+
+extern "C" void show_feed_spindle(uint32_t feedrate, uint32_t spindle_speed) {
+    status_event.status.feedrate = feedrate;
 }
 
 extern "C" void show_overrides(override_percent_t feed_ovr, override_percent_t rapid_ovr, override_percent_t spindle_ovr) {
-    myFro = feed_ovr;
+    status_event.status.has_overrides = true;
+    status_event.status.fro           = feed_ovr;
 }
 
 extern "C" void show_limits(bool probe, const bool* limits, size_t n_axis) {
-    myProbeSwitch = probe;
-    memcpy(myLimitSwitches, limits, n_axis * sizeof(*limits));
+    status_event.status.probe = probe;
+    memcpy(status_event.status.limits, limits, n_axis * sizeof(*limits));
 }
 extern "C" void show_dro(const pos_t* axes, const pos_t* wco, bool isMpos, bool* limits, size_t n_axis) {
+    auto& status  = status_event.status;
+    status.n_axis = n_axis;
     for (int axis = 0; axis < n_axis; axis++) {
-        myAxes[axis] = axes[axis];
+        status.axes[axis] = axes[axis];
         if (isMpos) {
-            myAxes[axis] -= wco[axis];
+            status.axes[axis] -= wco[axis];
         }
     }
 }
 
-void send_line(const String& s, int timeout) {
-    send_line(s.c_str(), timeout);
+extern "C" void end_status_report() {
+    const status_snapshot_t& status = status_event.status;
+    jog_latency_status(status.state, status.axes, status.n_axis);
+    link_status_report();
+
+    // If the UI has fallen behind, drop this report; a newer one will follow
+    post_fnc_event(status_event);
 }
-void send_line(const char* s, int timeout) {
-    fnc_send_line(s, timeout);
+
+extern "C" void show_error(int error) {
+    file_command_failed(unacked_line());
+    line_acked();
+
+    fnc_event_t event;
+    event.type  = EV_ERROR;
+    event.value = error;
+    post_fnc_event(event);
 }
 
-String axisNumToString(int axis) {
-    return String("XYZABC").substring(axis, axis + 1);
+extern "C" void show_timeout() {
+    link_timeout();
+    file_command_failed(unacked_line());
+    line_acked();
 }
 
-String floatToString(float val, int afterDecimal) {
-    char buffer[20];
-    dtostrf(val, 1, afterDecimal, buffer);
-    String str(buffer);
-    return str;
+extern "C" void show_malformed(const char* line) {
+    link_malformed(line);
 }
 
-String modeString() {
-    return myModeString;
+extern "C" void show_ok() {
+    jog_latency_ok();
+    line_acked();
 }
 
-extern "C" void show_state(const char* state_string) {
-    state_t new_state = decode_state_string(state_string);
-    if (state != new_state) {
-        state = new_state;
-        current_scene->onStateChange(state);
-    }
+extern "C" void handle_other(char* line) {
+    estimate_setting(line);
 }
 
-extern "C" void show_error(int error) {
-    errorExpire = millis() + 1000;
-    lastError   = error;
-    current_scene->reDisplay();
+extern "C" void show_alarm(int alarm) {
+    fnc_event_t event;
+    event.type  = EV_ALARM;
+    event.value = alarm;
+    post_fnc_event(event);
 }
 
-extern "C" void show_timeout() {}
+static const char* mode_or_empty(const char* mode) {
+    return mode ? mode : "";
+}
 
-extern "C" void end_status_report() {
-    current_scene->onDROChange();
+extern "C" void show_gcode_modes(struct gcode_modes* modes) {
+    fnc_event_t event;
+    event.type = EV_GCODE_MODES;
+    snprintf(event.text,
+             sizeof(event.text),
+             "%s|%s|%s|%s|%s|T%d",
+             mode_or_empty(modes->wcs),
+             mode_or_empty(modes->units),
+             mode_or_empty(modes->distance),
+             mode_or_empty(modes->spindle),
+             mode_or_empty(modes->coolant),
+             modes->tool);
+    post_fnc_event(event);
 }
 
-extern "C" void show_alarm(int alarm) {
-    lastAlarm = alarm;
-    current_scene->reDisplay();
+static void apply_status(const status_snapshot_t& status) {
+    state_t old_state = state;
+    store_state(status.state);
+    if (state != old_state && state == Idle) {
+        estimate_end_job();
+    }
+    store_job(status.has_file ? status.percent : 0, status.has_linenum ? status.linenum : 0);
+    store_motion(status.has_buffers ? status.planner_avail : -1, status.feedrate);
+    if (status.has_overrides) {
+        store_fro(status.fro);
+    }
+    if (status.n_axis) {
+        store_switches(status.limits, status.n_axis, status.probe);
+        store_axes(status.axes, status.n_axis);
+    }
+    store_report();
 }
 
-extern "C" void show_gcode_modes(struct gcode_modes* modes) {
-    myModeString = String(modes->wcs);
-    myModeString += "|" + String(modes->units);
-    myModeString += "|" + String(modes->distance);
-    myModeString += "|" + String(modes->spindle);
-    myModeString += "|" + String(modes->coolant);
-    myModeString += "|T" + String(modes->tool);
-    current_scene->reDisplay();
+void dispatch_fnc_events() {
+    fnc_event_t event;
+    while (get_fnc_event(event)) {
+        switch (event.type) {
+            case EV_STATUS:
+                apply_status(event.status);
+                break;
+            case EV_ERROR:
+                store_error(event.value);
+                break;
+            case EV_ALARM:
+                store_alarm(event.value);
+                break;
+            case EV_GCODE_MODES:
+                store_modes(event.text);
+                break;
+            case EV_FILES_START:
+                accept_file_list_start();
+                break;
+            case EV_FILES_LIST:
+                accept_file_list(event.files);
+                break;
+            case EV_FILES_END:
+                accept_file_list_end();
+                break;
+            case EV_FILES_FAILED:
+                accept_file_list_failed();
+                break;
+            case EV_FILE_LINES:
+                accept_file_lines(event.lines);
+                break;
+            case EV_FILES_CHANGED:
+                accept_files_changed();
+                break;
+            case EV_TOOLPATH:
+                accept_toolpath(event.toolpath);
+                break;
+            case EV_TOOLPATH_END:
+                accept_toolpath_end(event.value);
+                break;
+        }
+    }
+    state_publish();
 }
 
-int disconnect_ms = 0;
-int next_ping_ms  = 0;
+bool send_line(const String& s, int timeout) {
+    return send_line(s.c_str(), timeout);
+}
+bool send_line(const char* s, int timeout) {
+    return queue_line(s, timeout);
+}
+
+String axisNumToString(int axis) {
+    return String("XYZABC").substring(axis, axis + 1);
+}
+
+String floatToString(float val, int afterDecimal) {
+    char buffer[20];
+    dtostrf(val, 1, afterDecimal, buffer);
+    String str(buffer);
+    return str;
+}
+
+String modeString() {
+    return myModeString;
+}
 
-// If we haven't heard from FluidNC in 4 seconds for some other reason,
-// send a status report request.
-const int ping_interval_ms = 4000;
+// Written by the UI task here and by the ingest task in update_rx_time()
+std::atomic<int> disconnect_ms(0);
+std::atomic<int> next_ping_ms(0);
 
-// If we haven't heard from FluidNC in 6 seconds for any reason, declare
-// FluidNC unresponsive.  After a ping, FluidNC has 2 seconds to respond.
-const int disconnect_interval_ms = 6000;
+// If we haven't heard from FluidNC for a while for some other reason,
+// send a status report request.  If that goes unanswered for a few
+// round trip times, declare FluidNC unresponsive.  LinkHealth sets both
+// times from the measured round trip and any recent errors.
 
 bool starting = true;
 
 void request_status_report() {
     fnc_realtime(StatusReport);  // Request fresh status
-    next_ping_ms = milliseconds() + ping_interval_ms;
+    next_ping_ms = milliseconds() + link_ping_interval_ms();
 }
 
 bool fnc_is_connected() {
     int now = milliseconds();
     if (starting) {
         starting      = false;
-        disconnect_ms = now + (disconnect_interval_ms - ping_interval_ms);
+        disconnect_ms = now + link_response_ms();
         request_status_report();  // sets next_ping_ms
         return false;             // Do we need a value for "unknown"?
     }
     if ((now - disconnect_ms) >= 0) {
-        next_ping_ms  = now + ping_interval_ms;
-        disconnect_ms = now + disconnect_interval_ms;
+        int ping      = now + link_ping_interval_ms();
+        next_ping_ms  = ping;
+        disconnect_ms = ping + link_response_ms();
         return false;
     }
     if ((now - next_ping_ms) >= 0) {
@@ -196,7 +326,7 @@ bool fnc_is_connected() {
 }
 
 void update_rx_time() {
-    int now       = milliseconds();
-    next_ping_ms  = now + ping_interval_ms;
-    disconnect_ms = now + disconnect_interval_ms;
+    int ping      = milliseconds() + link_ping_interval_ms();
+    next_ping_ms  = ping;
+    disconnect_ms = ping + link_response_ms();
 }
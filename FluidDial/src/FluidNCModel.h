@@ -31,13 +31,17 @@ extern bool               myLimitSwitches[6];
 extern bool               myProbeSwitch;
 extern String             myFile;
 extern file_percent_t     myPercent;
+extern int                myLinenum;
+extern int                myPlannerAvail;
+extern uint32_t           myFeedrate;
 extern override_percent_t myFro;
 extern int                lastAlarm;
 extern int                lastError;
 extern uint32_t           errorExpire;
 
-void send_line(const String& s, int timeout = 2000);
-void send_line(const char* s, int timeout = 2000);
+// False if the line could not be queued because the link is busy
+bool send_line(const String& s, int timeout = 2000);
+bool send_line(const char* s, int timeout = 2000);
 
 String floatToString(float val, int afterDecimal);
 String axisNumToString(int axis);
@@ -50,3 +54,6 @@ bool fnc_is_connected();
 void set_disconnected_state();
 
 void update_rx_time();
+
+// Apply status reports and other parsed data posted by the ingest task
+void dispatch_fnc_events();
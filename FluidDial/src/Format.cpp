@@ -0,0 +1,100 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Format.h"
+
+TextBuf& TextBuf::add(const char* s) {
+    while (*s && _len < _cap - 1) {
+        _buf[_len++] = *s++;
+    }
+    _buf[_len] = '\0';
+    return *this;
+}
+
+TextBuf& TextBuf::add(char c) {
+    if (_len < _cap - 1) {
+        _buf[_len++] = c;
+        _buf[_len]   = '\0';
+    }
+    return *this;
+}
+
+static void add_digits(TextBuf& buf, uint32_t value, int min_digits) {
+    char digits[10];
+    int  n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value || n < min_digits);
+    while (n) {
+        buf.add(digits[--n]);
+    }
+}
+
+TextBuf& TextBuf::addInt(int32_t value) {
+    uint32_t magnitude = value;
+    if (value < 0) {
+        add('-');
+        magnitude = -(uint32_t)value;
+    }
+    add_digits(*this, magnitude, 1);
+    return *this;
+}
+
+TextBuf& TextBuf::addTime(uint32_t seconds) {
+    uint32_t hours = seconds / 3600;
+    if (hours) {
+        add_digits(*this, hours, 1);
+        add(':');
+        add_digits(*this, seconds / 60 % 60, 2);
+    } else {
+        add_digits(*this, seconds / 60, 1);
+    }
+    add(':');
+    add_digits(*this, seconds % 60, 2);
+    return *this;
+}
+
+TextBuf& TextBuf::addFixed(float value, int decimals) {
+    static const uint32_t scales[] = { 1, 10, 100, 1000, 10000 };
+    if (decimals < 0) {
+        decimals = 0;
+    }
+    if (decimals > 4) {
+        decimals = 4;
+    }
+    uint32_t scale = scales[decimals];
+
+    // Round to the nearest unit in the last place, in integer arithmetic
+    // from there on so no float formatting code is involved
+    bool     negative = value < 0;
+    uint64_t scaled   = (uint64_t)((negative ? -value : value) * scale + 0.5f);
+    if (scaled == 0) {
+        negative = false;  // No "-0.00"
+    }
+    if (negative) {
+        add('-');
+    }
+    add_digits(*this, scaled / scale, 1);
+    if (decimals) {
+        add('.');
+        add_digits(*this, scaled % scale, decimals);
+    }
+    return *this;
+}
+
+void TextBuf::clear() {
+    _len    = 0;
+    _buf[0] = '\0';
+}
+
+void TextBuf::truncate(size_t len) {
+    if (len < _len) {
+        _len       = len;
+        _buf[_len] = '\0';
+    }
+}
+
+char axisChar(int axis) {
+    return "XYZABC"[axis];
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Text formatting into fixed-capacity buffers, so that redraws and
+// commands can be built on the stack without touching the heap.
+// Text that does not fit is truncated.
+
+#pragma once
+#include <Arduino.h>
+
+class TextBuf {
+private:
+    char*  _buf;
+    size_t _cap;
+    size_t _len = 0;
+
+public:
+    TextBuf(char* buf, size_t cap) : _buf(buf), _cap(cap) { _buf[0] = '\0'; }
+    TextBuf(const TextBuf&)            = delete;
+    TextBuf& operator=(const TextBuf&) = delete;
+
+    TextBuf& add(const char* s);
+    TextBuf& add(char c);
+    TextBuf& addInt(int32_t value);
+    // Fixed-point decimal with exactly "decimals" digits after the point
+    TextBuf& addFixed(float value, int decimals);
+    // Duration as m:ss, or h:mm:ss from an hour up
+    TextBuf& addTime(uint32_t seconds);
+
+    void        clear();
+    void        truncate(size_t len);
+    const char* c_str() const { return _buf; }
+    size_t      length() const { return _len; }
+    operator const char*() const { return _buf; }
+};
+
+template <size_t N>
+class StackBuf : public TextBuf {
+private:
+    char _storage[N];
+
+public:
+    StackBuf() : TextBuf(_storage, N) {}
+    StackBuf(const char* s) : StackBuf() { add(s); }
+};
+
+// Formats one number for immediate use, e.g. text(Fixed(myFro, 0), ...)
+class Fixed : public StackBuf<20> {
+public:
+    Fixed(float value, int decimals) { addFixed(value, decimals); }
+};
+
+// Builds $J= and G-code lines from words, e.g.
+//   CommandBuf cmd("$J=G91");
+//   cmd.word('F', 1000).word('X', -0.1, 2);  // $J=G91F1000X-0.10
+class CommandBuf : public StackBuf<128> {
+public:
+    CommandBuf(const char* prefix) : StackBuf(prefix) {}
+    CommandBuf& word(char letter, int32_t value) {
+        add(letter).addInt(value);
+        return *this;
+    }
+    CommandBuf& word(char letter, float value, int decimals) {
+        add(letter).addFixed(value, decimals);
+        return *this;
+    }
+};
+
+char axisChar(int axis);
+
+class AxisName : public StackBuf<2> {
+public:
+    AxisName(int axis) { add(axisChar(axis)); }
+};
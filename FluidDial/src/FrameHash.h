@@ -0,0 +1,35 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// FNV-1a hash of the values that a scene draws.  If the hash of the
+// current values matches the one for the frame on the display, the
+// redraw would produce identical pixels and can be skipped.
+
+#pragma once
+#include <Arduino.h>
+
+class FrameHash {
+private:
+    uint32_t _value = 2166136261u;
+
+public:
+    FrameHash& add(const void* data, size_t len) {
+        const uint8_t* p = (const uint8_t*)data;
+        while (len--) {
+            _value = (_value ^ *p++) * 16777619u;
+        }
+        return *this;
+    }
+    FrameHash& add(int32_t value) { return add(&value, sizeof(value)); }
+    FrameHash& add(const char* s) { return add(s, strlen(s)); }
+    FrameHash& add(const String& s) { return add(s.c_str(), s.length()); }
+
+    // A number as displayed with "decimals" digits after the point,
+    // so changes too small to show do not cause a redraw
+    FrameHash& add(float value, int decimals) {
+        static const float scales[] = { 1, 10, 100, 1000, 10000 };
+        return add((int32_t)lroundf(value * scales[decimals]));
+    }
+
+    uint32_t value() const { return _value; }
+};
@@ -0,0 +1,188 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "GcodeInterp.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+void GcodeInterp::reset(GcodeSink* sink) {
+    *this = GcodeInterp();
+    _sink = sink;
+}
+
+void GcodeInterp::arc(const gcode_point& to, float cx, float cy, bool cw) {
+    float rx     = _pos.x - cx;
+    float ry     = _pos.y - cy;
+    float tx     = to.x - cx;
+    float ty     = to.y - cy;
+    float radius = hypotf(rx, ry);
+    float angle  = atan2f(rx * ty - ry * tx, rx * tx + ry * ty);
+    // Same end and start is a full circle
+    if (cw) {
+        if (angle >= -1e-6f) {
+            angle -= 2 * M_PI;
+        }
+    } else if (angle <= 1e-6f) {
+        angle += 2 * M_PI;
+    }
+
+    int steps = _sink->arc_steps(radius, fabsf(angle));
+    steps     = std::max(1, std::min(steps, MAX_ARC_STEPS));
+
+    // Z changes evenly along a helix
+    for (int i = 1; i < steps; i++) {
+        float       a = angle * i / steps;
+        float       c = cosf(a);
+        float       s = sinf(a);
+        gcode_point p = { cx + rx * c - ry * s, cy + rx * s + ry * c, _pos.z + (to.z - _pos.z) * i / steps };
+        _sink->move(p, false, _feed);
+    }
+    _sink->move(to, false, _feed);
+}
+
+void GcodeInterp::line(const char* s) {
+    bool  have_x = false, have_y = false, have_z = false, have_ij = false, have_r = false;
+    float vx = 0, vy = 0, vz = 0, vi = 0, vj = 0, vr = 0, vp = 0;
+    bool  no_motion = false;
+    bool  dwell     = false;
+
+    while (*s) {
+        char c = toupper(*s++);
+        if (c == '(') {
+            while (*s && *s++ != ')') {}
+            continue;
+        }
+        if (c == ';') {
+            break;
+        }
+        if (!isalpha(c)) {
+            continue;
+        }
+        char* end;
+        float value = strtof(s, &end);
+        if (end == s) {
+            continue;
+        }
+        s = end;
+        switch (c) {
+            case 'G':
+                switch ((int)lroundf(value * 10)) {  // G38.2 is 382
+                    case 0:
+                    case 10:
+                    case 20:
+                    case 30:
+                        _motion = value;
+                        break;
+                    case 40:
+                        dwell = true;
+                        break;
+                    case 200:
+                        _units = 25.4f;
+                        break;
+                    case 210:
+                        _units = 1.0f;
+                        break;
+                    case 900:
+                        _relative = false;
+                        break;
+                    case 910:
+                        _relative = true;
+                        break;
+                    case 100:  // G10
+                    case 280:  // G28
+                    case 300:  // G30
+                    case 382:  // Probing
+                    case 383:
+                    case 384:
+                    case 385:
+                    case 530:  // G53
+                    case 920:  // G92
+                        no_motion = true;
+                        break;
+                }
+                break;
+            case 'X':
+                vx     = value;
+                have_x = true;
+                break;
+            case 'Y':
+                vy     = value;
+                have_y = true;
+                break;
+            case 'Z':
+                vz     = value;
+                have_z = true;
+                break;
+            case 'I':
+                vi      = value;
+                have_ij = true;
+                break;
+            case 'J':
+                vj      = value;
+                have_ij = true;
+                break;
+            case 'R':
+                vr     = value;
+                have_r = true;
+                break;
+            case 'P':
+                vp = value;
+                break;
+            case 'F':
+                _feed = value * _units;
+                break;
+        }
+    }
+
+    if (dwell) {
+        _sink->dwell(vp);
+        return;
+    }
+
+    bool is_arc = _motion >= 2;
+    if (no_motion || !(have_x || have_y || have_z || (is_arc && have_ij))) {
+        return;
+    }
+    gcode_point to = _pos;
+    if (have_x) {
+        to.x = (_relative ? _pos.x : 0) + vx * _units;
+    }
+    if (have_y) {
+        to.y = (_relative ? _pos.y : 0) + vy * _units;
+    }
+    if (have_z) {
+        to.z = (_relative ? _pos.z : 0) + vz * _units;
+    }
+
+    if (!_known) {
+        _sink->jump(to);
+        _known = true;
+    } else if (!is_arc) {
+        _sink->move(to, _motion == 0, _feed);
+    } else {
+        bool  cw = _motion == 2;
+        float cx = _pos.x + vi * _units;
+        float cy = _pos.y + vj * _units;
+        if (have_r) {
+            // Center from the radius, as Grbl does it
+            float r  = vr * _units;
+            float dx = to.x - _pos.x;
+            float dy = to.y - _pos.y;
+            float h  = 4 * r * r - dx * dx - dy * dy;
+            float d  = hypotf(dx, dy);
+            h        = (h > 0 && d > 0) ? -sqrtf(h) / d : 0;
+            if (!cw) {
+                h = -h;
+            }
+            if (r < 0) {
+                h = -h;
+            }
+            cx = _pos.x + 0.5f * (dx - dy * h);
+            cy = _pos.y + 0.5f * (dy + dx * h);
+        }
+        arc(to, cx, cy, cw);
+    }
+    _pos = to;
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Just enough of a G-code interpreter to follow the tool through a job
+// file one line at a time: G0-G3 (arcs in the XY plane, with IJ or R),
+// G4, G20/G21, G90/G91 and F.  Moves that are not in program
+// coordinates (G10, G28, G30, G38.x, G53, G92) are skipped.  Positions
+// are in mm.
+
+#pragma once
+
+struct gcode_point {
+    float x;
+    float y;
+    float z;
+};
+
+// Where the interpreter sends the path
+class GcodeSink {
+public:
+    // The first move of a file, from an unknown position
+    virtual void jump(const gcode_point& to) {}
+
+    // Straight moves.  Arcs arrive as chords.  feed is mm/min.
+    virtual void move(const gcode_point& to, bool rapid, float feed) = 0;
+
+    virtual void dwell(float seconds) {}
+
+    // How many chords to split an arc into
+    virtual int arc_steps(float radius, float angle) = 0;
+};
+
+class GcodeInterp {
+private:
+    constexpr static const int MAX_ARC_STEPS = 256;
+
+    GcodeSink*  _sink     = nullptr;
+    gcode_point _pos      = { 0, 0, 0 };
+    bool        _known    = false;  // The start position is unknown until the first move
+    int         _motion   = 0;      // 0-3 for G0-G3
+    bool        _relative = false;
+    float       _units    = 1.0f;  // mm per program unit
+    float       _feed     = 0;     // mm/min
+
+    void arc(const gcode_point& to, float cx, float cy, bool cw);
+
+public:
+    void reset(GcodeSink* sink);
+    void line(const char* s);
+};
@@ -0,0 +1,211 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "GlyphAtlas.h"
+#include "FrameHash.h"
+#include <vector>
+#include <algorithm>
+
+extern const GFXfont* font[];
+
+constexpr static const int N_FONTS = MEDIUM_MONO + 1;
+
+// Digits, signs, decimal point and axis letters
+static const char atlas_chars[] = " +-.%:0123456789XYZABC";
+
+constexpr static const int N_GLYPHS = sizeof(atlas_chars) - 1;
+
+// One run of set pixels, relative to the glyph's top left corner
+struct span_t {
+    uint8_t row;
+    uint8_t x;
+    uint8_t len;
+};
+
+struct atlas_glyph {
+    int8_t   x_offset;
+    int8_t   y_offset;
+    uint8_t  width;
+    uint8_t  x_advance;
+    uint16_t first_span;
+    uint16_t n_spans;
+};
+
+struct font_atlas {
+    atlas_glyph         glyphs[N_GLYPHS];
+    std::vector<span_t> spans;
+    int                 baseline = 0;  // Tallest ascent in the font
+    int                 height   = 0;  // Tallest ascent plus deepest descent
+};
+
+static font_atlas atlases[N_FONTS];
+static bool       atlas_ready = false;
+
+// Character code to index in atlas_chars, or -1
+static int8_t glyph_index[128];
+
+static const atlas_glyph* find_glyph(const font_atlas& fa, char c) {
+    if ((uint8_t)c >= sizeof(glyph_index) || glyph_index[(uint8_t)c] < 0) {
+        return nullptr;
+    }
+    return &fa.glyphs[glyph_index[(uint8_t)c]];
+}
+
+static void decode_glyph(const GFXfont* f, char c, font_atlas& fa, atlas_glyph& ag) {
+    const GFXglyph& g    = f->glyph[c - f->first];
+    const uint8_t*  bits = f->bitmap + g.bitmapOffset;
+
+    ag.x_offset   = g.xOffset;
+    ag.y_offset   = g.yOffset;
+    ag.width      = g.width;
+    ag.x_advance  = g.xAdvance;
+    ag.first_span = fa.spans.size();
+
+    // GFX font bitmaps are packed MSB first with no padding between rows
+    uint32_t bit = 0;
+    for (int row = 0; row < g.height; row++) {
+        int start = -1;
+        for (int col = 0; col < g.width; col++, bit++) {
+            bool on = bits[bit >> 3] & (0x80 >> (bit & 7));
+            if (on && start < 0) {
+                start = col;
+            } else if (!on && start >= 0) {
+                fa.spans.push_back({ (uint8_t)row, (uint8_t)start, (uint8_t)(col - start) });
+                start = -1;
+            }
+        }
+        if (start >= 0) {
+            fa.spans.push_back({ (uint8_t)row, (uint8_t)start, (uint8_t)(g.width - start) });
+        }
+    }
+    ag.n_spans = fa.spans.size() - ag.first_span;
+}
+
+void init_glyph_atlas() {
+    memset(glyph_index, -1, sizeof(glyph_index));
+    for (int i = 0; i < N_GLYPHS; i++) {
+        glyph_index[(uint8_t)atlas_chars[i]] = i;
+    }
+
+    for (int fontnum = 0; fontnum < N_FONTS; fontnum++) {
+        const GFXfont* f  = font[fontnum];
+        font_atlas&    fa = atlases[fontnum];
+
+        // Vertical metrics over the whole font, which is what the
+        // datum placement in LovyanGFX is based on
+        int ascent  = 0;
+        int descent = 0;
+        for (int i = 0; i <= f->last - f->first; i++) {
+            int above = -f->glyph[i].yOffset;
+            ascent    = std::max(ascent, above);
+            descent   = std::max(descent, f->glyph[i].height - above);
+        }
+        fa.baseline = ascent;
+        fa.height   = ascent + descent;
+
+        for (int i = 0; i < N_GLYPHS; i++) {
+            decode_glyph(f, atlas_chars[i], fa, fa.glyphs[i]);
+        }
+        fa.spans.shrink_to_fit();
+    }
+    atlas_ready = true;
+}
+
+// Width from the atlas metrics, measured the way LovyanGFX does:
+// advances for all but the last glyph, plus the last glyph's extent
+static bool atlas_width(const font_atlas& fa, const char* msg, int& width) {
+    int left  = 0;
+    int right = 0;
+    for (const char* p = msg; *p; p++) {
+        auto g = find_glyph(fa, *p);
+        if (!g) {
+            return false;
+        }
+        if (p == msg && g->x_offset < 0) {
+            left = right = -g->x_offset;
+        }
+        right = left + std::max<int>(g->x_advance, g->width + g->x_offset);
+        left += g->x_advance;
+    }
+    width = right;
+    return true;
+}
+
+// Entries hold the text itself, so that a hash collision is a miss.
+// Longer text is measured every time.
+constexpr static const size_t WIDTH_TEXT_MAX = 32;
+
+struct width_entry {
+    char     text[WIDTH_TEXT_MAX];  // Empty for an unused entry
+    uint8_t  fontnum;
+    int16_t  width;
+};
+
+constexpr static const int WIDTH_CACHE_SIZE = 64;  // Power of 2
+static width_entry         width_cache[WIDTH_CACHE_SIZE];
+
+int text_width(const char* msg, fontnum_t fontnum) {
+    size_t len       = strlen(msg);
+    bool   cacheable = len && len < WIDTH_TEXT_MAX;
+
+    FrameHash hash;
+    hash.add(fontnum).add(msg);
+    auto& entry = width_cache[hash.value() & (WIDTH_CACHE_SIZE - 1)];
+    if (cacheable && entry.fontnum == fontnum && strcmp(entry.text, msg) == 0) {
+        return entry.width;
+    }
+
+    int width;
+    if (!atlas_ready || !atlas_width(atlases[fontnum], msg, width)) {
+        canvas.setFont(font[fontnum]);
+        width = canvas.textWidth(msg);
+    }
+    if (cacheable) {
+        memcpy(entry.text, msg, len + 1);
+        entry.fontnum = fontnum;
+        entry.width   = width;
+    }
+    return width;
+}
+
+bool atlas_text(const char* msg, int x, int y, int color, fontnum_t fontnum, int datum) {
+    if (!atlas_ready) {
+        return false;
+    }
+    const font_atlas& fa = atlases[fontnum];
+
+    int width;
+    if (!atlas_width(fa, msg, width)) {
+        return false;
+    }
+
+    int h_align = datum & (top_center | top_right);
+    if (h_align == top_center) {
+        x -= width >> 1;
+    } else if (h_align == top_right) {
+        x -= width;
+    }
+
+    // Move y to the baseline
+    int v_align = datum & baseline_left;
+    if (v_align != baseline_left) {
+        y += fa.baseline;
+        if (v_align == middle_left) {
+            y -= fa.height >> 1;
+        } else if (v_align == bottom_left) {
+            y -= fa.height;
+        }
+    }
+
+    for (const char* p = msg; *p; p++) {
+        auto          g    = find_glyph(fa, *p);
+        const span_t* span = fa.spans.data() + g->first_span;
+        int           gx   = x + g->x_offset;
+        int           gy   = y + g->y_offset;
+        for (int i = 0; i < g->n_spans; i++, span++) {
+            canvas.drawFastHLine(gx + span->x, gy + span->row, span->len, color);
+        }
+        x += g->x_advance;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Fast paths for the text that is redrawn most often.  The characters
+// used by DRO values and other numbers are decoded once at startup into
+// horizontal pixel spans, so drawing them is a handful of line fills
+// instead of a trip through the general font renderer.  Text widths are
+// cached so that fitting and aligning the same string is not repeated.
+
+#pragma once
+#include "Text.h"
+
+void init_glyph_atlas();
+
+// Draws msg if every character in it is in the atlas, else returns false
+bool atlas_text(const char* msg, int x, int y, int color, fontnum_t fontnum, int datum);
+
+// Same value as canvas.textWidth() with that font, remembered across calls
+int text_width(const char* msg, fontnum_t fontnum);
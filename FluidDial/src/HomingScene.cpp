@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
 
 class HomingScene : public Scene {
 private:
@@ -14,9 +15,9 @@ public:
     void onDialButtonPress() { pop_scene(); }
     void onGreenButtonPress() {
         if (state == Idle || state == Alarm) {
-            String line = "$H";
+            CommandBuf line("$H");
             if (_current_button != 0) {
-                line += axisNumToString(_current_button - 1);
+                line.add(axisChar(_current_button - 1));
             }
             log_println(line);
             send_line(line);
@@ -26,6 +27,9 @@ public:
             fnc_realtime(CycleStart);
         }
     }
+    realtime_cmd_t redFastAction() override { return state == Homing ? Reset : None; }
+    realtime_cmd_t greenFastAction() override { return state == Cycle ? FeedHold : None; }
+
     void onRedButtonPress() {
         if (state == Homing) {
             fnc_realtime(Reset);
@@ -40,14 +44,22 @@ public:
         }
     }
 
-    void onDROChange() { reDisplay(); }  // also covers any status change
+    void onDROChange() { redrawIfChanged(); }  // also covers any status change
+
+    void hashInputs(FrameHash& hash) override {
+        hashStatus(hash);
+        for (int axis = 0; axis < 3; axis++) {
+            hash.add(myLimitSwitches[axis]);
+        }
+    }
 
     void reDisplay() {
         drawBackground(BLACK);
         drawMenuTitle(current_scene->name());
         drawStatus();
 
-        String redLabel, grnLabel, orangeLabel = "";
+        const char*  redLabel = "";
+        StackBuf<16> grnLabel;
 
         if (state == Idle || state == Homing || state == Alarm) {
             int x      = 50;
@@ -70,17 +82,21 @@ public:
             if (state == Homing) {
                 redLabel = "E-Stop";
             } else {
-                grnLabel = "Home ";
-                grnLabel += _current_button ? axisNumToString(_current_button - 1) : "All";
+                grnLabel.add("Home ");
+                if (_current_button) {
+                    grnLabel.add(axisChar(_current_button - 1));
+                } else {
+                    grnLabel.add("All");
+                }
             }
         } else {
             centered_text("Invalid State", 105, WHITE, MEDIUM);
             centered_text("For Homing", 145, WHITE, MEDIUM);
             redLabel = "E-Stop";
             if (state == Cycle) {
-                grnLabel = "Hold";
+                grnLabel.add("Hold");
             } else if (state == Hold) {
-                grnLabel = "Resume";
+                grnLabel.add("Resume");
             }
         }
 
@@ -0,0 +1,237 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "InputEvents.h"
+#include "System.h"
+#include "Scene.h"  // The buttons
+#include "Encoder.h"
+#include "EventLoop.h"
+#include "SPSCRing.h"
+
+// Enough for a pass in which every source has something to say
+constexpr static const int MAX_PER_PASS = 8;
+
+static const char trace_prefix[] = "IN:";
+
+static SPSCRing<input_event_t, 32>  queue;
+static SPSCRing<input_event_t, 256> replay;  // A few minutes of use
+
+static bool recording = false;
+
+static bool          replaying    = false;
+static float         replay_speed = 1;
+static bool          replay_timed = false;  // The first event sets the time base
+static uint32_t      replay_base_trace;     // Trace time of the first event
+static uint32_t      replay_base_now;       // When it was released
+static bool          replay_held = false;   // replay_next is not yet due
+static input_event_t replay_next;
+
+// A trace being read from the debug port
+static bool   loading = false;
+static char   load_line[80];
+static size_t load_len     = 0;
+static int    load_count   = 0;
+static int    load_dropped = 0;
+
+static void push(const input_event_t& event) {
+    if (recording) {
+        char buf[80];
+        input_format_trace(event, buf, sizeof(buf));
+        log_println(buf);
+    }
+    queue.push(event);  // If the scene is that far behind, the event is dropped
+}
+
+static void add_button(input_event_t* events, int& n, Button& button, input_button_t which) {
+    bool pressed;
+    while (n < MAX_PER_PASS && button.changed(pressed)) {
+        events[n++] = { button.change_us(), pressed ? IN_BUTTON_PRESS : IN_BUTTON_RELEASE, which };
+    }
+}
+
+static void add_touch(input_event_t* events, int& n) {
+    static m5::touch_state_t last_touch_state = {};
+
+    auto this_touch = touch.getDetail();
+    if (this_touch.state == last_touch_state) {
+        return;
+    }
+    last_touch_state = this_touch.state;
+
+    input_event_t event = { (uint32_t)micros(), IN_NTYPES, 0, (int16_t)this_touch.x, (int16_t)this_touch.y };
+    if (this_touch.state == m5::touch_state_t::touch) {
+        event.type = IN_TOUCH_PRESS;
+    } else if (this_touch.wasClicked()) {
+        event.type = IN_TOUCH_RELEASE;
+    } else if (this_touch.wasHold()) {
+        event.type = IN_TOUCH_HOLD;
+    } else if (this_touch.state == m5::touch_state_t::flick_end) {
+        event.type = IN_TOUCH_FLICK;
+        event.dx   = this_touch.distanceX();
+        event.dy   = this_touch.distanceY();
+    }
+    if (event.type != IN_NTYPES) {
+        events[n++] = event;
+    }
+}
+
+static void release_replay() {
+    uint32_t now = micros();
+    while (replay_held || replay.pop(replay_next)) {
+        replay_held = true;
+        if (!replay_timed) {
+            replay_base_trace = replay_next.time_us;
+            replay_base_now   = now;
+            replay_timed      = true;
+        }
+        uint32_t due = replay_base_now + (uint32_t)((replay_next.time_us - replay_base_trace) / replay_speed);
+        if ((int32_t)(now - due) < 0) {
+            event_wake_within((due - now) / 1000 + 1);
+            return;
+        }
+        replay_held = false;
+
+        input_event_t event = replay_next;
+        event.time_us       = due;  // The time on this run
+        push(event);
+    }
+    replaying = false;
+    log_println("Replay done");
+}
+
+void collect_inputs() {
+    input_event_t events[MAX_PER_PASS];
+    int           n = 0;
+
+    encoder_motion motion;
+    if (take_encoder_motion(motion)) {
+        events[n]         = { motion.first_us, IN_ENCODER };
+        events[n++].delta = motion.delta;
+    }
+    add_button(events, n, dialButton, IN_DIAL);
+    add_button(events, n, redButton, IN_RED);
+    add_button(events, n, greenButton, IN_GREEN);
+    if (n < MAX_PER_PASS) {
+        add_touch(events, n);
+    }
+
+    if (replaying) {
+        release_replay();
+        return;
+    }
+
+    // The sources are read one after another, so put them in time order.
+    // An insertion sort keeps the order of equal times and needs no heap.
+    for (int i = 1; i < n; i++) {
+        input_event_t event = events[i];
+        int           j     = i;
+        for (; j > 0 && (int32_t)(event.time_us - events[j - 1].time_us) < 0; --j) {
+            events[j] = events[j - 1];
+        }
+        events[j] = event;
+    }
+    for (int i = 0; i < n; i++) {
+        push(events[i]);
+    }
+}
+
+bool next_input(input_event_t& event) {
+    return queue.pop(event);
+}
+
+void input_set_recording(bool on) {
+    recording = on;
+}
+bool input_recording() {
+    return recording;
+}
+
+void input_format_trace(const input_event_t& e, char* buf, size_t len) {
+    snprintf(buf, len, "%s%u %d %d %d %d %d %d %d", trace_prefix, e.time_us, e.type, e.button, e.delta, e.x, e.y, e.dx, e.dy);
+}
+
+bool input_parse_trace(const char* line, input_event_t& e) {
+    if (strncmp(line, trace_prefix, strlen(trace_prefix)) != 0) {
+        return false;
+    }
+    unsigned time_us;
+    int      type, button, delta, x, y, dx, dy;
+    if (sscanf(line + strlen(trace_prefix), "%u %d %d %d %d %d %d %d", &time_us, &type, &button, &delta, &x, &y, &dx, &dy) != 8) {
+        return false;
+    }
+    if (type < 0 || type >= IN_NTYPES) {
+        return false;
+    }
+    e = { time_us, (input_type_t)type, (uint8_t)button, (int16_t)x, (int16_t)y, (int16_t)dx, (int16_t)dy, delta };
+    return true;
+}
+
+void input_replay_clear() {
+    input_event_t discard;
+    while (replay.pop(discard)) {}
+    replay_held = false;
+}
+
+bool input_replay_add(const input_event_t& event) {
+    return replay.push(event);
+}
+
+void input_replay_start(float speed) {
+    replay_speed = speed > 0 ? speed : 1;
+    replay_timed = false;
+    replaying    = true;
+}
+
+void input_replay_end() {
+    replaying = false;
+}
+
+static void end_load_line() {
+    load_line[load_len] = '\0';
+    load_len            = 0;
+    if (!*load_line) {
+        return;  // The other half of a CRLF
+    }
+    input_event_t event;
+    if (input_parse_trace(load_line, event)) {
+        if (input_replay_add(event)) {
+            ++load_count;
+        } else {
+            ++load_dropped;
+        }
+        return;
+    }
+    loading = false;
+
+    float speed = atof(load_line);
+    char  buf[80];
+    snprintf(buf, sizeof(buf), "Replaying %d events at %gx, %d dropped", load_count, speed > 0 ? speed : 1, load_dropped);
+    log_println(buf);
+    input_replay_start(speed);
+}
+
+bool input_replay_command(char c) {
+    if (!loading) {
+        if (c != 'J' && c != 'j') {
+            return false;
+        }
+        input_replay_end();
+        input_replay_clear();
+        loading      = true;
+        load_len     = 0;
+        load_count   = 0;
+        load_dropped = 0;
+        log_println("Replay: send the IN: lines, then a line with the speed");
+        return true;
+    }
+    if (c == '\r' || c == '\n') {
+        end_load_line();
+    } else if (load_len < sizeof(load_line) - 1) {
+        load_line[load_len++] = c;
+    }
+    return true;
+}
+
+bool input_replaying() {
+    return replaying;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// One queue for all operator input.  Each pass, collect_inputs() takes
+// what the encoder, buttons and touch panel have seen since the last
+// pass, stamps it with the time it happened, and queues it in time
+// order; dispatch_events() hands the queue to the scene.
+//
+// The queue can be recorded as text lines on the debug port, and a
+// recorded trace can be fed back in place of the live inputs, at the
+// original speed or faster, to reproduce an operator session.
+
+#pragma once
+#include <Arduino.h>
+
+enum input_type_t : uint8_t {
+    IN_ENCODER = 0,     // delta, in encoder counts
+    IN_BUTTON_PRESS,    // button
+    IN_BUTTON_RELEASE,  // button
+    IN_TOUCH_PRESS,     // x, y
+    IN_TOUCH_RELEASE,   // x, y
+    IN_TOUCH_HOLD,      // x, y
+    IN_TOUCH_FLICK,     // x, y, dx, dy
+    IN_NTYPES,
+};
+
+enum input_button_t : uint8_t {
+    IN_DIAL = 0,
+    IN_RED,
+    IN_GREEN,
+};
+
+struct input_event_t {
+    uint32_t     time_us;
+    input_type_t type;
+    uint8_t      button;
+    int16_t      x;
+    int16_t      y;
+    int16_t      dx;
+    int16_t      dy;
+    int32_t      delta;
+};
+
+// Poll the input sources into the queue
+void collect_inputs();
+
+// The oldest queued event
+bool next_input(input_event_t& event);
+
+// Recording prints each event as it is collected, as a line like
+//   IN:<time_us> <type> <button> <delta> <x> <y> <dx> <dy>
+void input_set_recording(bool on);
+bool input_recording();
+void input_format_trace(const input_event_t& event, char* buf, size_t len);
+bool input_parse_trace(const char* line, input_event_t& event);
+
+// A trace is loaded with input_replay_add() and then played with
+// input_replay_start().  While replaying, live input is read and thrown
+// away, and each event is queued when its recorded spacing, divided by
+// speed, has passed.  Replay ends after the last event, or at
+// input_replay_end().
+void input_replay_clear();
+bool input_replay_add(const input_event_t& event);  // false if full
+void input_replay_start(float speed);
+void input_replay_end();
+bool input_replaying();
+
+// Debug port: 'J', then the IN: lines of a recording, then a line with
+// the speed, replays the recording.  Returns true if c was taken as part
+// of that command.
+bool input_replay_command(char c);
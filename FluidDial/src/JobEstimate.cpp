@@ -0,0 +1,376 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JobEstimate.h"
+#include "FileParser.h"    // current_filename
+#include "FluidNCModel.h"  // send_line()
+#include "Format.h"        // CommandBuf
+
+#include <math.h>
+#include <algorithm>
+
+// Used until FluidNC reports its own.  These are the FluidNC defaults.
+constexpr static const float DEFAULT_MAX_RATE = 1000.0f;  // mm/min
+constexpr static const float DEFAULT_ACCEL    = 25.0f;    // mm/sec^2
+
+constexpr static const float JUNCTION_DEVIATION = 0.01f;   // mm
+constexpr static const float ARC_TOLERANCE      = 0.002f;  // mm, how FluidNC splits arcs
+
+constexpr static const int N_PLAN  = 16;   // Look-ahead, as in the FluidNC planner
+constexpr static const int N_INDEX = 128;  // Samples of the time at a line
+
+constexpr static const int N_LIMIT_AXES = 3;
+
+static const char limit_axes[] = "xyz";
+
+// Written on the ingest task, by replies to request_motion_settings()
+static float max_rate[N_LIMIT_AXES]  = { DEFAULT_MAX_RATE, DEFAULT_MAX_RATE, DEFAULT_MAX_RATE };
+static float max_accel[N_LIMIT_AXES] = { DEFAULT_ACCEL, DEFAULT_ACCEL, DEFAULT_ACCEL };
+
+struct time_sample {
+    int32_t  line;
+    uint32_t byte;
+    float    seconds;  // From the start of the job to the start of the line
+};
+
+struct time_index {
+    time_sample samples[N_INDEX];
+    int         n = 0;
+    float       total;  // Seconds
+    int32_t     lines;
+    uint32_t    bytes;
+
+    // Seconds at a line or byte position, between the samples around it
+    float at(float position, bool by_line) const {
+        if (n == 0 || position < key(samples[0], by_line)) {
+            return 0;
+        }
+        int i = 0;
+        while (i + 1 < n && key(samples[i + 1], by_line) <= position) {
+            ++i;
+        }
+        float start    = key(samples[i], by_line);
+        float end      = i + 1 < n ? key(samples[i + 1], by_line) : by_line ? lines : bytes;
+        float seconds  = samples[i].seconds;
+        float end_secs = i + 1 < n ? samples[i + 1].seconds : total;
+        if (end <= start) {
+            return seconds;
+        }
+        return seconds + (end_secs - seconds) * std::min((position - start) / (end - start), 1.0f);
+    }
+
+private:
+    static float key(const time_sample& s, bool by_line) { return by_line ? s.line : s.byte; }
+};
+
+// Built by the ingest task during a scan pass, read by the UI after it
+static time_index scan;
+
+// Copied from scan when a job starts, so that scanning another file
+// does not change it
+static time_index job;
+static bool       job_active = false;
+
+// Ingest side
+
+static float block_time(float length, float v0, float v1, float v, float accel) {
+    float d_accel = (v * v - v0 * v0) / (2 * accel);
+    float d_decel = (v * v - v1 * v1) / (2 * accel);
+    if (d_accel + d_decel <= length) {
+        return (v - v0) / accel + (v - v1) / accel + (length - d_accel - d_decel) / v;
+    }
+    // Never reaches the nominal speed
+    float peak2 = accel * length + (v0 * v0 + v1 * v1) / 2;
+    if (peak2 < std::max(v0 * v0, v1 * v1)) {
+        return 2 * length / (v0 + v1);  // Cannot change speed that much; should not happen
+    }
+    float peak = sqrtf(peak2);
+    return (peak - v0) / accel + (peak - v1) / accel;
+}
+
+class Estimator : public GcodeSink {
+private:
+    struct plan_block {
+        float    length;     // mm
+        float    nominal;    // mm/sec
+        float    accel;      // mm/sec^2
+        float    max_entry;  // mm/sec
+        float    entry;      // mm/sec
+        int32_t  line;
+        uint32_t byte;
+    };
+
+    plan_block  _blocks[N_PLAN];
+    int         _oldest = 0;
+    int         _count  = 0;
+    gcode_point _pos;
+    float       _unit[3];  // Direction of the last move, for the junction speed
+    float       _last_nominal;
+    bool        _stopped = true;  // The next move starts from rest
+    int32_t     _line    = 0;
+    uint32_t    _byte    = 0;
+    int32_t     _next_sample;
+    int32_t     _stride;
+
+    plan_block& block(int i) { return _blocks[(_oldest + i) % N_PLAN]; }
+
+    void add_sample(const plan_block& b) {
+        if (b.line < _next_sample) {
+            return;
+        }
+        if (scan.n == N_INDEX) {
+            // Keep every other sample and sample half as often
+            for (int i = 0; i < N_INDEX / 2; i++) {
+                scan.samples[i] = scan.samples[2 * i];
+            }
+            scan.n = N_INDEX / 2;
+            _stride *= 2;
+        }
+        scan.samples[scan.n++] = { b.line, b.byte, scan.total };
+        _next_sample           = b.line + _stride;
+    }
+
+    // The oldest block can no longer change, so add up its time
+    void retire() {
+        plan_block& b    = block(0);
+        float       exit = _count > 1 ? block(1).entry : 0;
+        add_sample(b);
+        scan.total += block_time(b.length, b.entry, exit, b.nominal, b.accel);
+        _oldest = (_oldest + 1) % N_PLAN;
+        --_count;
+    }
+
+    // Reverse then forward passes over the look-ahead, as in the planner.
+    // The oldest block's entry speed is already fixed.
+    void replan() {
+        float exit = 0;  // Plan to stop after the newest block
+        for (int i = _count - 1; i > 0; i--) {
+            plan_block& b = block(i);
+            b.entry       = std::min(b.max_entry, sqrtf(exit * exit + 2 * b.accel * b.length));
+            exit          = b.entry;
+        }
+        for (int i = 0; i + 1 < _count; i++) {
+            plan_block& b    = block(i);
+            plan_block& next = block(i + 1);
+            next.entry       = std::min(next.entry, sqrtf(b.entry * b.entry + 2 * b.accel * b.length));
+        }
+    }
+
+    void stop() {
+        while (_count) {
+            retire();
+        }
+        _stopped = true;
+    }
+
+public:
+    void begin() {
+        _oldest      = 0;
+        _count       = 0;
+        _pos         = { 0, 0, 0 };
+        _stopped     = true;
+        _line        = 0;
+        _byte        = 0;
+        _next_sample = 0;
+        _stride      = 1;
+        scan.n       = 0;
+        scan.total   = 0;
+        scan.bytes   = 0;
+    }
+    void end() {
+        stop();
+        scan.lines = _line;
+        scan.bytes = _byte;
+    }
+    void line(int32_t line, uint32_t byte) {
+        _line = line;
+        _byte = byte;
+    }
+
+    void jump(const gcode_point& to) override {
+        stop();
+        _pos = to;
+    }
+
+    void dwell(float seconds) override {
+        stop();
+        scan.total += seconds;
+    }
+
+    void move(const gcode_point& to, bool rapid, float feed) override {
+        float delta[3] = { to.x - _pos.x, to.y - _pos.y, to.z - _pos.z };
+        float length   = sqrtf(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+        _pos           = to;
+        if (length < 1e-4f) {
+            return;
+        }
+
+        // The axis limits, scaled to the direction of the move
+        float unit[3];
+        float rate  = INFINITY;
+        float accel = INFINITY;
+        for (int axis = 0; axis < 3; axis++) {
+            unit[axis] = delta[axis] / length;
+            float part = fabsf(unit[axis]);
+            if (part > 1e-6f) {
+                rate  = std::min(rate, max_rate[axis] / 60 / part);
+                accel = std::min(accel, max_accel[axis] / part);
+            }
+        }
+        float nominal = (rapid || feed <= 0) ? rate : std::min(rate, feed / 60);
+
+        float max_entry = 0;
+        if (!_stopped) {
+            // Junction deviation, as in the planner
+            float cos_theta = -(_unit[0] * unit[0] + _unit[1] * unit[1] + _unit[2] * unit[2]);
+            float junction;
+            if (cos_theta > 0.999999f) {
+                junction = 0;  // Reversal
+            } else if (cos_theta < -0.999999f) {
+                junction = INFINITY;  // Straight on
+            } else {
+                float sin_half = sqrtf(0.5f * (1 - cos_theta));
+                junction       = sqrtf(accel * JUNCTION_DEVIATION * sin_half / (1 - sin_half));
+            }
+            max_entry = std::min({ junction, nominal, _last_nominal });
+        }
+        memcpy(_unit, unit, sizeof(unit));
+        _last_nominal = nominal;
+        _stopped      = false;
+
+        if (_count == N_PLAN) {
+            retire();
+        }
+        plan_block& b = block(_count++);
+        b.length      = length;
+        b.nominal     = nominal;
+        b.accel       = accel;
+        b.max_entry   = max_entry;
+        b.entry       = max_entry;
+        b.line        = _line;
+        b.byte        = _byte;
+        replan();
+    }
+
+    int arc_steps(float radius, float angle) override {
+        if (radius <= ARC_TOLERANCE) {
+            return 1;
+        }
+        return ceilf(angle / (2 * acosf(1 - ARC_TOLERANCE / radius)));
+    }
+} estimator;
+
+GcodeSink& estimate_sink() {
+    return estimator;
+}
+
+void estimate_begin() {
+    estimator.begin();
+}
+
+void estimate_line(int line, uint32_t byte) {
+    estimator.line(line, byte);
+}
+
+void estimate_end() {
+    estimator.end();
+}
+
+static bool is_key(const char* s, size_t len, const char* key) {
+    return strlen(key) == len && strncmp(s, key, len) == 0;
+}
+
+// Replies look like $/axes/x/max_rate_mm_per_min=1000.000
+bool estimate_setting(const char* line) {
+    const char* prefix = "$/axes/";
+    if (strncmp(line, prefix, strlen(prefix)) != 0) {
+        return false;
+    }
+    line += strlen(prefix);
+    const char* axis = strchr(limit_axes, tolower(line[0]));
+    if (!axis || !*axis || line[1] != '/') {
+        return false;
+    }
+    const char* equals = strchr(line, '=');
+    if (!equals) {
+        return false;
+    }
+    float value = atof(equals + 1);
+    if (value <= 0) {
+        return false;
+    }
+    int    n   = axis - limit_axes;
+    size_t len = equals - line - 2;
+    if (is_key(line + 2, len, "max_rate_mm_per_min")) {
+        max_rate[n] = value;
+        return true;
+    }
+    if (is_key(line + 2, len, "acceleration_mm_per_sec2")) {
+        max_accel[n] = value;
+        return true;
+    }
+    return false;
+}
+
+// UI side
+
+static String estimate_file;
+
+void request_motion_settings() {
+    static bool requested = false;
+    if (requested) {
+        return;
+    }
+    requested = true;
+    for (const char* a = limit_axes; *a; a++) {
+        CommandBuf command("$/axes/");
+        command.add(*a).add("/max_rate_mm_per_min");
+        send_line(command);
+        command.clear();
+        command.add("$/axes/").add(*a).add("/acceleration_mm_per_sec2");
+        send_line(command);
+    }
+}
+
+void estimate_forget() {
+    estimate_file = "";
+}
+
+void estimate_finished() {
+    estimate_file = current_filename;
+}
+
+bool estimate_ready() {
+    return estimate_file.length() && estimate_file == current_filename;
+}
+
+float estimate_total() {
+    return scan.total;
+}
+
+void estimate_start_job() {
+    job_active = estimate_ready();
+    if (job_active) {
+        job = scan;
+    }
+}
+
+void estimate_end_job() {
+    job_active = false;
+}
+
+bool job_remaining(int line, int percent, float& seconds) {
+    if (!job_active) {
+        return false;
+    }
+    float done;
+    if (line > 0) {
+        done = job.at(line, true);
+    } else if (percent > 0) {
+        done = job.at((float)job.bytes * percent / 100, false);
+    } else {
+        return false;
+    }
+    seconds = std::max(job.total - done, 0.0f);
+    return true;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Run time of a job file, estimated while the file streams past for
+// the toolpath thumbnail.  Moves go through a simplified version of the
+// FluidNC planner - trapezoidal speed profiles, per-axis rate and
+// acceleration limits, junction deviation, and a look-ahead of 16
+// moves.  A sampled index of the time at each line turns the progress
+// in status reports into the time remaining.
+
+#pragma once
+#include <Arduino.h>
+#include "GcodeInterp.h"
+
+// Ingest side, during the scan pass of the thumbnail
+GcodeSink& estimate_sink();
+void       estimate_begin();
+void       estimate_line(int line, uint32_t byte);  // Before each line, counting from 1
+void       estimate_end();
+
+// Ingest side: a reply to request_motion_settings()
+bool estimate_setting(const char* line);
+
+// UI side
+void  request_motion_settings();  // Ask FluidNC for the axis limits, once
+void  estimate_forget();          // A new scan pass is starting
+void  estimate_finished();        // The scan pass of current_filename has ended
+bool  estimate_ready();           // There is an estimate for current_filename
+float estimate_total();           // Seconds
+
+// The previewed file is being run, so keep its estimate for the job
+void estimate_start_job();
+void estimate_end_job();
+
+// Seconds left in the job, from the line number if there is one, else
+// from the percentage of the file read
+bool job_remaining(int line, int percent, float& seconds);
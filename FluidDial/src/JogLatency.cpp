@@ -0,0 +1,156 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JogLatency.h"
+#include "System.h"
+#include <atomic>
+#include <algorithm>
+
+// Buckets are powers of two in ms: <1, <2, <4 ... <1024, and the rest
+constexpr static const int N_BUCKETS = 12;
+
+// A detent that did not lead to a jog line this soon was for something else
+constexpr static const uint32_t DETENT_EXPIRE_US = 500000;
+
+// A jog that has not moved this long after it was sent was probably rejected
+constexpr static const uint32_t GIVE_UP_US = 2000000;
+
+struct stage_stats {
+    uint32_t count              = 0;
+    uint32_t min_us             = UINT32_MAX;
+    uint32_t max_us             = 0;
+    uint64_t total_us           = 0;
+    uint32_t buckets[N_BUCKETS] = { 0 };
+};
+
+static const char* stage_names[JOG_NSTAGES] = { "edge", "scaled", "queued", "sent", "ok", "jog", "moved" };
+
+// Written by the ingest task.  jog_latency_report() reads them without
+// a lock, which at worst prints one sample out of step.
+static stage_stats stats[JOG_NSTAGES];
+static uint32_t    abandoned = 0;
+
+// The UI task owns the stamps until it sets tracking, then the ingest
+// task owns them until it clears it
+static std::atomic<bool> tracking(false);
+static uint32_t          stamps[JOG_NSTAGES];
+
+// UI side: the detent waiting for its jog line
+static uint32_t pending_edge   = 0;
+static uint32_t pending_scaled = 0;
+
+// Ingest side
+static pos_t  last_axes[MAX_N_AXIS];
+static pos_t  start_axes[MAX_N_AXIS];
+static size_t last_n_axis = 0;
+
+static bool is_jog(const char* line) {
+    return strncmp(line, "$J=", 3) == 0;
+}
+
+static void add_sample(stage_stats& s, uint32_t us) {
+    ++s.count;
+    s.total_us += us;
+    s.min_us = std::min(s.min_us, us);
+    s.max_us = std::max(s.max_us, us);
+
+    int bucket = 0;
+    for (uint32_t ms = us / 1000; ms && bucket < N_BUCKETS - 1; ms >>= 1) {
+        ++bucket;
+    }
+    ++s.buckets[bucket];
+}
+
+void jog_latency_detent(uint32_t edge_us) {
+    uint32_t now = micros();
+    if (pending_scaled && now - pending_scaled <= DETENT_EXPIRE_US) {
+        return;  // Keep the first detent of a batch
+    }
+    // An older one was for something that sends no jog, like scrolling
+    // a menu, so it is replaced rather than holding off the next jog
+    pending_scaled = now;
+    pending_edge   = edge_us ? edge_us : pending_scaled;
+}
+
+void jog_latency_queued(const char* line) {
+    if (!is_jog(line) || !pending_scaled) {
+        return;
+    }
+    uint32_t now = micros();
+    bool     old = now - pending_scaled > DETENT_EXPIRE_US;
+    if (!old && !tracking.load(std::memory_order_acquire)) {
+        memset(stamps, 0, sizeof(stamps));
+        stamps[JOG_EDGE]   = pending_edge;
+        stamps[JOG_SCALED] = pending_scaled;
+        stamps[JOG_QUEUED] = now;
+        tracking.store(true, std::memory_order_release);
+    }
+    pending_scaled = 0;
+}
+
+void jog_latency_sent(const char* line) {
+    if (!tracking.load(std::memory_order_acquire) || stamps[JOG_SENT] || !is_jog(line)) {
+        return;
+    }
+    stamps[JOG_SENT] = micros();
+    memcpy(start_axes, last_axes, sizeof(start_axes));
+}
+
+void jog_latency_ok() {
+    if (tracking.load(std::memory_order_acquire) && stamps[JOG_SENT] && !stamps[JOG_OK]) {
+        stamps[JOG_OK] = micros();
+    }
+}
+
+static void finish() {
+    for (int i = JOG_SCALED; i < JOG_NSTAGES; i++) {
+        if (stamps[i]) {
+            add_sample(stats[i], stamps[i] - stamps[JOG_EDGE]);
+        }
+    }
+    tracking.store(false, std::memory_order_release);
+}
+
+void jog_latency_status(const char* state, const pos_t* axes, size_t n_axis) {
+    if (tracking.load(std::memory_order_acquire) && stamps[JOG_SENT]) {
+        uint32_t now = micros();
+        if (!stamps[JOG_STATE] && strcmp(state, "Jog") == 0) {
+            stamps[JOG_STATE] = now;
+        }
+        bool moved = false;
+        for (size_t axis = 0; axis < std::min(n_axis, last_n_axis); axis++) {
+            moved = moved || fabsf(axes[axis] - start_axes[axis]) > 0.0005f;
+        }
+        if (moved) {
+            stamps[JOG_MOVED] = now;
+            finish();
+        } else if (now - stamps[JOG_SENT] > GIVE_UP_US) {
+            ++abandoned;
+            tracking.store(false, std::memory_order_release);
+        }
+    }
+    if (n_axis) {
+        memcpy(last_axes, axes, n_axis * sizeof(*axes));
+        last_n_axis = n_axis;
+    }
+}
+
+void jog_latency_report() {
+    char buf[160];
+    snprintf(buf,
+             sizeof(buf),
+             "Jog latency: %u jogs, %u abandoned (us after the encoder edge; ms buckets <1 <2 <4 ... <1024 more)",
+             stats[JOG_MOVED].count,
+             abandoned);
+    log_println(buf);
+    for (int i = JOG_SCALED; i < JOG_NSTAGES; i++) {
+        const stage_stats& s   = stats[i];
+        uint32_t           min = s.count ? s.min_us : 0;
+        uint32_t           avg = s.count ? s.total_us / s.count : 0;
+        int n = snprintf(buf, sizeof(buf), "  %-6s n=%u %u/%u/%u |", stage_names[i], s.count, min, avg, s.max_us);
+        for (int b = 0; b < N_BUCKETS && n < (int)sizeof(buf); b++) {
+            n += snprintf(buf + n, sizeof(buf) - n, " %u", s.buckets[b]);
+        }
+        log_println(buf);
+    }
+}
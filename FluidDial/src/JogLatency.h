@@ -0,0 +1,35 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Latency of dial jogs, from the first encoder edge to the machine
+// moving.  One jog at a time is followed through the stages below, first
+// on the UI task and then on the ingest task, and the time of each stage
+// after the encoder edge goes into a histogram.  'L' on the debug port
+// dumps the histograms.
+
+#pragma once
+#include <Arduino.h>
+#include "GrblParserC.h"  // pos_t
+
+enum jog_stage_t {
+    JOG_EDGE = 0,  // First encoder count, in the interrupt handler
+    JOG_SCALED,    // Scene::scale_encoder() produced a detent
+    JOG_QUEUED,    // A $J line was queued for the ingest task
+    JOG_SENT,      // The $J line went to the UART
+    JOG_OK,        // FluidNC acknowledged it
+    JOG_STATE,     // First status report in the Jog state
+    JOG_MOVED,     // First status report with a changed position
+    JOG_NSTAGES,
+};
+
+// UI task
+void jog_latency_detent(uint32_t edge_us);  // Time of the first encoder count
+void jog_latency_queued(const char* line);
+
+// Ingest task
+void jog_latency_sent(const char* line);
+void jog_latency_ok();
+void jog_latency_status(const char* state, const pos_t* axes, size_t n_axis);
+
+// Histograms since boot, to debugPort
+void jog_latency_report();
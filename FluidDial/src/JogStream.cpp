@@ -0,0 +1,100 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JogStream.h"
+#include "FluidNCModel.h"  // send_line(), myAxes, myFeedrate, myPlannerAvail
+#include "Format.h"        // CommandBuf
+#include "EventLoop.h"     // event_wake_within()
+#include "MachineState.h"  // state_subscribe()
+#include "FNCIngest.h"     // cancel_jogs()
+
+#include <algorithm>
+
+constexpr static const int SEGMENT_MS = 100;  // Motion in one jog segment
+constexpr static const int AHEAD_MS   = 250;  // Most motion queued in FluidNC
+constexpr static const int REPORT_MS  = 100;  // Status report interval while jogging
+constexpr static const int MIN_FREE   = 2;    // Planner blocks to leave free
+
+void JogStream::start(int axis, int dir, int feed) {
+    if (_running) {
+        return;
+    }
+    if (_subscription < 0) {
+        _subscription = state_subscribe(SF_REPORT, on_report, this);
+    }
+    uint32_t now = millis();
+    _axis        = axis;
+    _dir         = dir;
+    _feed        = feed;
+    _start_pos   = myAxes[axis];
+    _sent        = 0;
+    _moved       = 0;
+    _velocity    = 0;
+    _report_time = now;
+    _unreported  = 0;
+    _next_ping   = now;
+    _running     = true;
+    poll();
+}
+
+void JogStream::stop() {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    cancel_jogs();
+}
+
+void JogStream::on_report(uint16_t changed, void* arg) {
+    static_cast<JogStream*>(arg)->report();
+}
+
+// Every status report, changed or not, resets the count of segments
+// that the reported Bf: does not yet include
+void JogStream::report() {
+    if (!_running) {
+        return;
+    }
+    _moved       = std::max(_dir * (myAxes[_axis] - _start_pos), 0.0f);
+    _velocity    = myFeedrate;
+    _report_time = millis();
+    _unreported  = 0;
+}
+
+// Distance sent but not yet moved, extrapolated from the last report
+float JogStream::queued(uint32_t now) {
+    float moved = _moved + _velocity * (now - _report_time) / 60000;
+    return std::max(_sent - moved, 0.0f);
+}
+
+bool JogStream::planner_room() {
+    if (myPlannerAvail < 0) {
+        return true;  // Not reported, so only the distance limits the stream
+    }
+    return myPlannerAvail - _unreported > MIN_FREE;
+}
+
+void JogStream::poll() {
+    if (!_running) {
+        return;
+    }
+    uint32_t now = millis();
+    if ((int32_t)(now - _next_ping) >= 0) {
+        fnc_realtime(StatusReport);
+        _next_ping = now + REPORT_MS;
+    }
+
+    float segment = _feed * SEGMENT_MS / 60000.0f;
+    float ahead   = _feed * AHEAD_MS / 60000.0f;
+    while (queued(now) + segment <= ahead && planner_room()) {
+        // $J=G91F1000X1.667
+        CommandBuf cmd("$J=G91");
+        cmd.word('F', _feed).word(axisChar(_axis), _dir * segment, 3);
+        if (!send_line(cmd)) {
+            break;  // The link is busy; try again on the next tick
+        }
+        _sent += segment;
+        ++_unreported;
+    }
+    event_wake_within(SEGMENT_MS / 2);
+}
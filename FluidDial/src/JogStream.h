@@ -0,0 +1,41 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Continuous jogging while a button is held.  Instead of one long jog
+// that must be cancelled, short jog segments are sent just ahead of the
+// machine.  The distance still to move is tracked from the position and
+// feed rate in status reports, and from the free planner blocks (Bf:)
+// when FluidNC reports them, so no more than a fraction of a second of
+// motion is ever queued and the machine stops soon after release even
+// if the JogCancel is late.
+
+#pragma once
+#include <Arduino.h>
+
+class JogStream {
+private:
+    int      _axis;
+    int      _dir;
+    int      _feed;             // mm/min
+    bool     _running = false;
+    float    _start_pos;        // Where the axis was at start()
+    float    _sent;             // mm sent since start()
+    float    _moved;            // mm moved at the last report
+    float    _velocity;         // mm/min at the last report
+    uint32_t _report_time;      // When _moved and _velocity were updated
+    int      _unreported;       // Segments sent since the last report
+    uint32_t _next_ping;        // When to ask for the next report
+    int      _subscription = -1;  // To status reports
+
+    static void on_report(uint16_t changed, void* arg);
+    void        report();
+    float       queued(uint32_t now);
+    bool        planner_room();
+
+public:
+    void start(int axis, int dir, int feed);
+    void set_feed(int feed) { _feed = feed; }
+    void stop();
+    void poll();  // From onTick()
+    bool running() { return _running; }
+};
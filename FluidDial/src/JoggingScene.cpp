@@ -3,6 +3,10 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
+#include "MpgJog.h"
+#include "JogStream.h"
+#include "FNCIngest.h"
 
 class JoggingScene : public Scene {
 private:
@@ -17,6 +21,9 @@ private:
 
     int _cont_speed[3] = { 1000, 1000, 1000 };
 
+    MpgJog    _mpg;
+    JogStream _stream;
+
     // Saved to NVS
     int _inc_level[3]  = { 2, 2, 1 };  // exponent 0=0.01, 2=0.1 ... 5 = 100.00
     int _rate_level[3] = { 1000, 1000, 100 };
@@ -47,8 +54,10 @@ private:
         }
     }
     void cancelJog() {
+        _mpg.cancel();
+        _stream.stop();
         if (state == Jog) {
-            fnc_realtime(JogCancel);
+            cancel_jogs();
         }
     }
 
@@ -69,8 +78,7 @@ public:
     void onGreenButtonPress() {
         if (state == Idle) {
             if (_continuous) {
-                // $J=G91F1000X10000
-                send_line("$J=G91F" + floatToString(_cont_speed[_axis], 0) + axisNumToString(_axis) + "10000");
+                _stream.start(_axis, 1, _cont_speed[_axis]);
             } else {
                 if (_active_setting == 0) {
                     if (_inc_level[_axis] != MAX_INC) {
@@ -94,11 +102,12 @@ public:
         }
     }
 
+    realtime_cmd_t redFastAction() override { return (!_continuous && (state == Jog || state == Cycle)) ? Reset : None; }
+
     void onRedButtonPress() {
         if (state == Idle) {
             if (_continuous) {
-                // $J=G91F1000X-10000
-                send_line("$J=G91F" + floatToString(_cont_speed[_axis], 0) + axisNumToString(_axis) + "-10000");
+                _stream.start(_axis, -1, _cont_speed[_axis]);
             } else {
                 if (_active_setting == 0) {
                     if (_inc_level[_axis] > 0) {
@@ -134,7 +143,8 @@ public:
             } else if (y < 105) {
                 rotateNumberLoop(_axis, 1, 0, 2);
             } else if (y < 140) {
-                String cmd = "G10L20P0" + axisNumToString(_axis) + "0";
+                CommandBuf cmd("G10L20P0");
+                cmd.word(axisChar(_axis), 0);
                 log_println(cmd);
                 send_line(cmd);
             } else {
@@ -145,34 +155,37 @@ public:
         reDisplay();
     }
 
-    void onDROChange() { reDisplay(); }
-    void onLimitsChange() { reDisplay(); }
+    void onDROChange() { redrawIfChanged(); }
+    void onLimitsChange() { redrawIfChanged(); }
+
+    // Only the selected axis is shown, so motion on the others is ignored
+    void hashInputs(FrameHash& hash) override {
+        hashStatus(hash);
+        DRO::hash(hash, _axis);
+        hash.add(_axis);
+    }
     void onAlarm() { reDisplay(); }
 
     void onEncoder(int delta) {
-        if (state == Idle && _continuous) {
+        if (_continuous && (state == Idle || _stream.running())) {
             feedRateRotator(_cont_speed[_axis], delta > 0);
+            _stream.set_feed(_cont_speed[_axis]);
         } else {
-            // $J=G91F200Z5.0
-            String jogRate      = floatToString(_rate_level[_axis], 0);
-            String jogIncrement = floatToString(_increment(), 2);
-            String cmd          = "$J=G91F" + jogRate + axisNumToString(_axis);
-            if (delta < 0) {
-                cmd += "-";
-            }
-            cmd += jogIncrement;
-            log_println(cmd);
-            send_line(cmd);
+            _mpg.setup(_axis, _increment(), _rate_level[_axis]);
+            _mpg.detents(delta, encoderTime());
         }
         reDisplay();
     }
+    void onTick() override {
+        _mpg.poll();
+        _stream.poll();
+    }
 
     void reDisplay() {
         drawBackground(BLACK);
-        String legend;
+        StackBuf<24> legend;
 
-        legend = _continuous ? "Bttn Jog" : "MPG Jog";
-        centered_text(legend, 12);
+        centered_text(_continuous ? "Bttn Jog" : "MPG Jog", 12);
 
         drawStatus();
 
@@ -192,32 +205,38 @@ public:
 
             if (state == Idle) {
                 Stripe stripe(x, y, width, height, TINY);
-                legend = "Zero " + String("XYZ").substring(_axis, _axis + 1) + " Axis";
+                legend.clear();
+                legend.add("Zero ").add(axisChar(_axis)).add(" Axis");
                 stripe.draw(legend, true);
             }
 
             if (_continuous) {
-                legend = "Rate: " + floatToString(_cont_speed[_axis], 0);
+                legend.clear();
+                legend.add("Rate: ").addInt(_cont_speed[_axis]);
                 centered_text(legend, 183);
             } else {
-                legend = "Increment: " + floatToString(_increment(), 2);
+                legend.clear();
+                legend.add("Increment: ").addFixed(_increment(), 2);
                 centered_text(legend, 174, _active_setting == 0 ? WHITE : DARKGREY);
-                legend = "Rate: " + floatToString(_rate_level[_axis], 2);
+                legend.clear();
+                legend.add("Rate: ").addFixed(_rate_level[_axis], 2);
                 centered_text(legend, 194, _active_setting == 1 ? WHITE : DARKGREY);
             }
 
             const char* back = "Back";
+            StackBuf<8> zero("Zero ");
+            zero.add(axisChar(_axis));
             switch (state) {
                 case Idle:
                     if (_continuous) {
                         if (_selection % 2) {
-                            drawButtonLegends("", "Zero " + axisNumToString(_axis), back);
+                            drawButtonLegends("", zero, back);
                         } else {
                             drawButtonLegends("Jog-", "Jog+", back);
                         }
                     } else {
                         if (_selection % 2) {  // if zro selected
-                            drawButtonLegends("", "Zero " + axisNumToString(_axis), back);
+                            drawButtonLegends("", zero, back);
                         } else {
                             drawButtonLegends("Dec", "Inc", back);
                         }
@@ -0,0 +1,261 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "JsonScanner.h"
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+void JsonScanner::reset() {
+    _state    = IDLE;
+    _depth    = 0;
+    _in_array = 0;
+    _len      = 0;
+}
+
+// Skips the rest of the document, starting with the character that
+// was wrong.  Nesting and strings are followed, so that a bracket
+// inside the broken document is not taken for the start of a new one.
+void JsonScanner::fail(char c) {
+    _handler.error();
+    _len   = 0;
+    _state = _state == UNICODE ? SKIP_STRING : SKIP;
+    skip(c);
+}
+
+void JsonScanner::skip(char c) {
+    switch (_state) {
+        case SKIP_STRING:
+            if (c == '\\') {
+                _state = SKIP_ESCAPE;
+            } else if (c == '"') {
+                _state = SKIP;
+            }
+            return;
+
+        case SKIP_ESCAPE:
+            _state = SKIP_STRING;
+            return;
+
+        default:
+            if (c == '"') {
+                _state = SKIP_STRING;
+            } else if (c == '{' || c == '[') {
+                ++_depth;
+            } else if ((c == '}' || c == ']') && --_depth == 0) {
+                reset();
+            }
+            return;
+    }
+}
+
+// UTF-8 encode, so names with non-ASCII characters survive
+void JsonScanner::add_codepoint(uint16_t cp) {
+    if (cp < 0x80) {
+        add(cp);
+    } else if (cp < 0x800) {
+        add(0xc0 | (cp >> 6));
+        add(0x80 | (cp & 0x3f));
+    } else {
+        add(0xe0 | (cp >> 12));
+        add(0x80 | ((cp >> 6) & 0x3f));
+        add(0x80 | (cp & 0x3f));
+    }
+}
+
+void JsonScanner::start(char type) {
+    if (_depth == MAX_DEPTH) {
+        fail(type);
+        return;
+    }
+    ++_depth;
+    if (type == '[') {
+        _in_array |= 1 << (_depth - 1);
+        _state = VALUE;
+    } else {
+        _in_array &= ~(1 << (_depth - 1));
+        _state = KEY;
+    }
+    _handler.start(type, _depth);
+}
+
+void JsonScanner::end(char type) {
+    if (type != (in_array() ? ']' : '}')) {
+        fail(type);  // Taken as closing the container anyway
+        return;
+    }
+    _handler.end(type, _depth);
+    if (--_depth == 0) {
+        _state = IDLE;
+        _handler.end_document();
+    } else {
+        _state = NEXT;
+    }
+}
+
+void JsonScanner::end_token() {
+    _token[_len] = '\0';
+    _len         = 0;
+}
+
+void JsonScanner::end_value() {
+    end_token();
+    _handler.value(_token, _state == STRING, _depth);
+    _state = NEXT;
+}
+
+void JsonScanner::parse(char c) {
+    switch (_state) {
+        case IDLE:
+            // Anything outside a document, like a partial one from
+            // before a reset, is ignored
+            if (c == '{' || c == '[') {
+                start(c);
+            }
+            return;
+
+        case SKIP:
+        case SKIP_STRING:
+        case SKIP_ESCAPE:
+            skip(c);
+            return;
+
+        case STRING:
+            if (c == '"') {
+                if (_is_key) {
+                    end_token();
+                    _handler.key(_token, _depth);
+                    _state = COLON;
+                } else {
+                    end_value();
+                }
+            } else if (c == '\\') {
+                _state = ESCAPE;
+            } else {
+                add(c);
+            }
+            return;
+
+        case ESCAPE:
+            _state = STRING;
+            switch (c) {
+                case 'n':
+                    add('\n');
+                    break;
+                case 't':
+                    add('\t');
+                    break;
+                case 'r':
+                    add('\r');
+                    break;
+                case 'b':
+                    add('\b');
+                    break;
+                case 'f':
+                    add('\f');
+                    break;
+                case 'u':
+                    _codepoint = 0;
+                    _hex_left  = 4;
+                    _state     = UNICODE;
+                    break;
+                default:  // \" \\ \/
+                    add(c);
+                    break;
+            }
+            return;
+
+        case UNICODE: {
+            int digit = hex_value(c);
+            if (digit < 0) {
+                fail(c);
+                return;
+            }
+            _codepoint = (_codepoint << 4) | digit;
+            if (--_hex_left == 0) {
+                add_codepoint(_codepoint);
+                _state = STRING;
+            }
+            return;
+        }
+
+        case LITERAL:
+            if (c == ',' || c == '}' || c == ']' || is_space(c)) {
+                end_value();
+                break;  // Handle c in state NEXT
+            }
+            add(c);
+            return;
+
+        default:
+            break;
+    }
+
+    if (is_space(c)) {
+        return;
+    }
+
+    switch (_state) {
+        case KEY:
+            if (c == '"') {
+                _is_key = true;
+                _state  = STRING;
+            } else if (c == '}') {
+                end(c);
+            } else {
+                fail(c);
+            }
+            return;
+
+        case COLON:
+            if (c == ':') {
+                _state = VALUE;
+            } else {
+                fail(c);
+            }
+            return;
+
+        case VALUE:
+            if (c == '"') {
+                _is_key = false;
+                _state  = STRING;
+            } else if (c == '{' || c == '[') {
+                start(c);
+            } else if (c == ']' && in_array()) {
+                end(c);  // Empty array
+            } else if (c == ',' || c == ':' || c == '}' || c == ']') {
+                fail(c);
+            } else {
+                add(c);
+                _state = LITERAL;
+            }
+            return;
+
+        case NEXT:
+            if (c == ',') {
+                _state = in_array() ? VALUE : KEY;
+            } else if (c == '}' || c == ']') {
+                end(c);
+            } else {
+                fail(c);
+            }
+            return;
+
+        default:
+            return;
+    }
+}
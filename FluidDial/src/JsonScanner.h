@@ -0,0 +1,84 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// A small streaming JSON scanner for the documents FluidNC sends in
+// [MSG:JSON: lines.  It is fed one character at a time, so a document
+// can be split anywhere across lines, and it reports keys and scalar
+// values from a fixed token buffer instead of building a String for
+// each one.  It starts over by itself after each complete document.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+class JsonScanner {
+public:
+    // Longer strings are truncated.  Enough for any file name.
+    constexpr static const size_t MAX_TOKEN = 255;
+
+    // Depth is 1 inside the top-level object or array, 2 inside a
+    // container in that, and so on.  Strings passed to key() and
+    // value() are only valid during the call.
+    class Handler {
+    public:
+        virtual void start(char type, int depth) {}  // type is '{' or '['
+        virtual void end(char type, int depth) {}
+        virtual void key(const char* key, int depth) {}
+        virtual void value(const char* value, bool quoted, int depth) {}
+        virtual void end_document() {}
+        virtual void error() {}  // The rest of the document is skipped, up to its last bracket
+    };
+
+    explicit JsonScanner(Handler& handler) : _handler(handler) {}
+
+    void parse(char c);
+    void parse(const char* s) {
+        while (*s) {
+            parse(*s++);
+        }
+    }
+    void reset();
+
+private:
+    enum state_t : uint8_t {
+        IDLE,         // Between documents
+        VALUE,        // Expecting a value
+        KEY,          // Expecting a key or the end of an object
+        COLON,        // After a key
+        NEXT,         // After a value, expecting a comma or an end
+        STRING,       // In a string
+        ESCAPE,       // After a backslash in a string
+        UNICODE,      // In the hex digits of \uXXXX
+        LITERAL,      // In a number, true, false or null
+        SKIP,         // After an error, until the document closes
+        SKIP_STRING,  // In a string while skipping
+        SKIP_ESCAPE,  // After a backslash in a string while skipping
+    };
+
+    constexpr static const int MAX_DEPTH = 32;
+
+    Handler& _handler;
+    state_t  _state     = IDLE;
+    bool     _is_key    = false;
+    int      _depth     = 0;
+    uint32_t _in_array  = 0;  // Bit n is set if the container at depth n+1 is an array
+    uint16_t _codepoint = 0;
+    uint8_t  _hex_left  = 0;
+    size_t   _len       = 0;
+    char     _token[MAX_TOKEN + 1];
+
+    bool in_array() const { return _in_array & (1 << (_depth - 1)); }
+
+    void add(char c) {
+        if (_len < MAX_TOKEN) {
+            _token[_len++] = c;
+        }
+    }
+    void add_codepoint(uint16_t cp);
+    void start(char type);
+    void end(char type);
+    void end_token();
+    void end_value();
+    void fail(char c);
+    void skip(char c);
+};
@@ -0,0 +1,61 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LineCache.h"
+
+void LineBlock::push_back(const char* line) {
+    size_t length = strlen(line);
+    if (_text.size() + length + 1 > UINT16_MAX) {
+        return;  // Far more than a block of preview lines
+    }
+    _offsets.push_back(_text.size());
+    _text.insert(_text.end(), line, line + length + 1);
+}
+
+void LineBlock::reserve(size_t n_lines, size_t text_bytes) {
+    _offsets.reserve(n_lines);
+    _text.reserve(text_bytes);
+}
+
+const LineBlock* LineCache::find(int line) {
+    for (int i = 0; i < N_BLOCKS; i++) {
+        if (_blocks[i] && _blocks[i]->has(line)) {
+            _last_used[i] = ++_clock;
+            return _blocks[i];
+        }
+    }
+    return nullptr;
+}
+
+void LineCache::insert(LineBlock* block) {
+    int victim = 0;
+    for (int i = 0; i < N_BLOCKS; i++) {
+        if (!_blocks[i]) {
+            victim = i;
+            break;
+        }
+        if (_last_used[i] < _last_used[victim]) {
+            victim = i;
+        }
+    }
+    delete _blocks[victim];
+    _blocks[victim]    = block;
+    _last_used[victim] = ++_clock;
+}
+
+void LineCache::clear() {
+    for (auto& block : _blocks) {
+        delete block;
+        block = nullptr;
+    }
+}
+
+size_t LineCache::heap_bytes() const {
+    size_t bytes = 0;
+    for (auto block : _blocks) {
+        if (block) {
+            bytes += sizeof(LineBlock) + block->heap_bytes();
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Lines of a previewed file, fetched a block at a time.  A block keeps
+// its lines end to end in one buffer, like FileList does with names,
+// and the cache keeps the most recently used blocks of one file.
+
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+class LineBlock {
+private:
+    std::vector<char>     _text;     // NUL-terminated lines, end to end
+    std::vector<uint16_t> _offsets;  // Of each line in _text
+
+public:
+    int first = 0;  // Line number of the first line, counting from 0
+
+    size_t      size() const { return _offsets.size(); }
+    const char* operator[](size_t i) const { return &_text[_offsets[i]]; }
+    bool        has(int line) const { return line >= first && line < first + (int)size(); }
+
+    void push_back(const char* line);
+    void reserve(size_t n_lines, size_t text_bytes);
+
+    size_t heap_bytes() const { return _text.capacity() + _offsets.capacity() * sizeof(uint16_t); }
+};
+
+class LineCache {
+private:
+    constexpr static const int N_BLOCKS = 8;
+
+    LineBlock* _blocks[N_BLOCKS] = {};
+    uint32_t   _last_used[N_BLOCKS];
+    uint32_t   _clock = 0;
+
+public:
+    ~LineCache() { clear(); }
+
+    // The block holding the line, or nullptr.  Counts as a use.
+    const LineBlock* find(int line);
+
+    // Takes ownership, replacing the least recently used block if full
+    void insert(LineBlock* block);
+
+    void clear();
+
+    size_t heap_bytes() const;
+};
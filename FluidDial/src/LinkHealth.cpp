@@ -0,0 +1,193 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "LinkHealth.h"
+#include "System.h"
+#include "GrblParserC.h"  // StatusReport
+#include <atomic>
+#include <algorithm>
+
+// A '?' that has not been answered this long was lost
+constexpr static const uint32_t LOST_US = 2000000;
+
+// The wait for a ping's answer is a few round trips, within these limits
+constexpr static const int RESPONSE_MIN_MS   = 500;
+constexpr static const int RESPONSE_MAX_MS   = 2000;  // Also the wait before there is a measurement
+constexpr static const int RESPONSE_SLACK_MS = 200;   // For FluidNC being busy, e.g. with a file listing
+
+// A quiet link is pinged every PING_MS, or every TROUBLE_PING_MS for
+// TROUBLE_MS after any error, so that a failing cable is noticed sooner
+constexpr static const int PING_MS         = 4000;
+constexpr static const int TROUBLE_PING_MS = 1000;
+constexpr static const int TROUBLE_MS      = 10000;
+
+// When the oldest unanswered '?' went out, or 0
+static std::atomic<uint32_t> ping_us(0);
+
+// Read by fnc_is_connected() on the UI task
+static std::atomic<uint32_t> srtt_us(0);     // Smoothed round trip, 0 until measured
+static std::atomic<uint32_t> trouble_ms(0);  // Time of the last error, or 0
+
+// Counted by more than one task
+static std::atomic<uint32_t> lost(0);
+static std::atomic<uint32_t> timeouts(0);
+static std::atomic<uint32_t> overruns(0);
+static std::atomic<uint32_t> rx_errors(0);
+
+// Written by the ingest task.  link_get_stats() reads them without a
+// lock, which at worst gives one sample out of step.
+static uint32_t reports        = 0;
+static uint32_t rtt_count      = 0;
+static uint32_t rtt_min_us     = UINT32_MAX;
+static uint32_t rtt_max_us     = 0;
+static uint32_t gap_count      = 0;
+static uint64_t gap_total_us   = 0;
+static uint32_t gap_max_us     = 0;
+static uint32_t last_report_us = 0;
+static uint32_t malformed      = 0;
+static uint32_t rx_bytes       = 0;
+static char     last_bad[48]   = "";
+
+static void note_trouble() {
+    trouble_ms.store(millis() | 1, std::memory_order_relaxed);
+}
+
+void link_sent(uint8_t c) {
+    if (c != StatusReport) {
+        return;
+    }
+    // Time the oldest '?', since a later one may be answered by the same report
+    uint32_t now  = micros() | 1;
+    uint32_t sent = ping_us.load(std::memory_order_relaxed);
+    if (sent && now - sent < LOST_US) {
+        return;
+    }
+    if (ping_us.compare_exchange_strong(sent, now) && sent) {
+        ++lost;
+        note_trouble();
+    }
+}
+
+void link_received() {
+    ++rx_bytes;
+}
+
+void link_status_report() {
+    uint32_t now = micros();
+    ++reports;
+    if (last_report_us) {
+        uint32_t gap = now - last_report_us;
+        ++gap_count;
+        gap_total_us += gap;
+        gap_max_us = std::max(gap_max_us, gap);
+    }
+    last_report_us = now;
+
+    uint32_t sent = ping_us.exchange(0);
+    if (!sent) {
+        return;  // Not asked for, or the answer to a '?' already timed
+    }
+    uint32_t rtt = now - sent;
+    if (rtt >= LOST_US) {
+        ++lost;
+        note_trouble();
+        return;
+    }
+    ++rtt_count;
+    rtt_min_us = std::min(rtt_min_us, rtt);
+    rtt_max_us = std::max(rtt_max_us, rtt);
+
+    // Smoothed like a TCP round trip estimate, 1/8 of each new sample
+    int32_t srtt = srtt_us.load(std::memory_order_relaxed);
+    srtt         = srtt ? srtt + ((int32_t)rtt - srtt) / 8 : rtt;
+    srtt_us.store(std::max(srtt, 1), std::memory_order_relaxed);
+}
+
+void link_malformed(const char* line) {
+    ++malformed;
+    size_t i;
+    for (i = 0; i < sizeof(last_bad) - 1 && line[i]; i++) {
+        last_bad[i] = (uint8_t)line[i] < ' ' ? '.' : line[i];  // Line noise would upset the terminal
+    }
+    last_bad[i] = '\0';
+    note_trouble();
+}
+
+void link_timeout() {
+    ++timeouts;
+    note_trouble();
+}
+
+void link_uart_error(bool overrun) {
+    if (overrun) {
+        ++overruns;
+    } else {
+        ++rx_errors;
+    }
+    note_trouble();
+}
+
+int link_response_ms() {
+    uint32_t srtt = srtt_us.load(std::memory_order_relaxed);
+    if (!srtt) {
+        return RESPONSE_MAX_MS;
+    }
+    return std::min(std::max((int)(4 * srtt / 1000) + RESPONSE_SLACK_MS, RESPONSE_MIN_MS), RESPONSE_MAX_MS);
+}
+
+int link_ping_interval_ms() {
+    uint32_t trouble = trouble_ms.load(std::memory_order_relaxed);
+    if (trouble && millis() - trouble < TROUBLE_MS) {
+        return TROUBLE_PING_MS;
+    }
+    return PING_MS;
+}
+
+void link_get_stats(link_stats_t& stats) {
+    stats.reports    = reports;
+    stats.rtt_count  = rtt_count;
+    stats.rtt_min_ms = rtt_count ? rtt_min_us / 1000 : 0;
+    stats.rtt_avg_ms = srtt_us.load(std::memory_order_relaxed) / 1000;
+    stats.rtt_max_ms = rtt_max_us / 1000;
+    stats.gap_avg_ms = gap_count ? gap_total_us / gap_count / 1000 : 0;
+    stats.gap_max_ms = gap_max_us / 1000;
+    stats.lost       = lost;
+    stats.malformed  = malformed;
+    stats.timeouts   = timeouts;
+    stats.overruns   = overruns;
+    stats.rx_errors  = rx_errors;
+    stats.rx_bytes   = rx_bytes;
+}
+
+void link_report() {
+    link_stats_t s;
+    link_get_stats(s);
+    char buf[160];
+    snprintf(buf,
+             sizeof(buf),
+             "Link: %u reports, rtt n=%u %u/%u/%u ms, gap %u/%u ms, ping %d ms, wait %d ms",
+             s.reports,
+             s.rtt_count,
+             s.rtt_min_ms,
+             s.rtt_avg_ms,
+             s.rtt_max_ms,
+             s.gap_avg_ms,
+             s.gap_max_ms,
+             link_ping_interval_ms(),
+             link_response_ms());
+    log_println(buf);
+    snprintf(buf,
+             sizeof(buf),
+             "  %u bytes, %u lost pings, %u malformed, %u timeouts, %u overruns, %u rx errors",
+             s.rx_bytes,
+             s.lost,
+             s.malformed,
+             s.timeouts,
+             s.overruns,
+             s.rx_errors);
+    log_println(buf);
+    if (*last_bad) {
+        log_print("  last malformed: ");
+        log_println(last_bad);
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Quality of the serial link to FluidNC.  The time from a '?' to the
+// status report that answers it, the gaps between status reports, lines
+// the parser could not use, ack timeouts and UART receive errors are
+// counted here.  The measured round trip sets how long fnc_is_connected()
+// waits for an answer, and recent errors make it ping more often.  'H'
+// on the debug port prints the numbers; the Setup scene shows them too.
+
+#pragma once
+#include <Arduino.h>
+
+struct link_stats_t {
+    uint32_t reports;      // Status reports received
+    uint32_t rtt_count;    // Reports that answered a '?'
+    uint32_t rtt_min_ms;
+    uint32_t rtt_avg_ms;   // Smoothed, as used for the response window
+    uint32_t rtt_max_ms;
+    uint32_t gap_avg_ms;   // Between status reports
+    uint32_t gap_max_ms;
+    uint32_t lost;         // '?' with no report within LOST_MS
+    uint32_t malformed;    // Lines too long, with control characters, or bad reports
+    uint32_t timeouts;     // Lines FluidNC did not acknowledge in time
+    uint32_t overruns;     // UART FIFO or RX buffer full, so bytes were lost
+    uint32_t rx_errors;    // UART framing, parity and break errors
+    uint32_t rx_bytes;
+};
+
+// Any task: a byte is going to FluidNC
+void link_sent(uint8_t c);
+
+// Ingest task
+void link_received();  // A byte from FluidNC
+void link_status_report();
+void link_malformed(const char* line);
+void link_timeout();
+
+// UART driver's event task
+void link_uart_error(bool overrun);
+
+// For fnc_is_connected()
+int link_response_ms();       // How long to wait for the answer to a ping
+int link_ping_interval_ms();  // How long a quiet link goes without a ping
+
+void link_get_stats(link_stats_t& stats);
+void link_report();  // To debugPort
@@ -0,0 +1,151 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MachineState.h"
+#include "Scene.h"
+#include "System.h"  // myModeString
+#include "EventLoop.h"
+
+constexpr static const int MAX_SUBSCRIBERS = 8;
+constexpr static const int ERROR_SHOW_MS   = 1000;
+
+struct subscriber {
+    uint16_t         fields;
+    state_listener_t listener;
+    void*            arg;
+};
+
+static subscriber subscribers[MAX_SUBSCRIBERS];
+static uint32_t   versions[SF_NFIELDS];
+static uint16_t   changed       = 0;  // Since the last state_publish()
+static bool       error_showing = false;
+
+static void mark(uint16_t fields) {
+    changed |= fields;
+    for (int i = 0; i < SF_NFIELDS; i++) {
+        if (fields & (1 << i)) {
+            ++versions[i];
+        }
+    }
+}
+
+template <typename T>
+static void update(T& variable, T value, uint16_t field) {
+    if (variable != value) {
+        variable = value;
+        mark(field);
+    }
+}
+
+int state_subscribe(uint16_t fields, state_listener_t listener, void* arg) {
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].listener) {
+            subscribers[i] = { fields, listener, arg };
+            return i;
+        }
+    }
+    return -1;
+}
+
+void state_unsubscribe(int id) {
+    if (id >= 0 && id < MAX_SUBSCRIBERS) {
+        subscribers[id].listener = nullptr;
+    }
+}
+
+uint32_t state_version(state_field_t field) {
+    return versions[__builtin_ctz(field)];
+}
+
+void store_state(const char* state_string) {
+    if (stateString != state_string) {
+        state = decode_state_string(state_string);
+        mark(SF_STATE);
+    }
+}
+
+void store_disconnected() {
+    if (state != Disconnected) {
+        set_disconnected_state();
+        mark(SF_STATE);
+    }
+}
+
+void store_axes(const pos_t* axes, size_t n_axis) {
+    if (memcmp(myAxes, axes, n_axis * sizeof(*axes)) != 0) {
+        memcpy(myAxes, axes, n_axis * sizeof(*axes));
+        mark(SF_POSITION);
+    }
+}
+
+void store_switches(const bool* limits, size_t n_axis, bool probe) {
+    if (memcmp(myLimitSwitches, limits, n_axis * sizeof(*limits)) != 0 || myProbeSwitch != probe) {
+        memcpy(myLimitSwitches, limits, n_axis * sizeof(*limits));
+        myProbeSwitch = probe;
+        mark(SF_SWITCHES);
+    }
+}
+
+void store_job(file_percent_t percent, int linenum) {
+    update(myPercent, percent, SF_JOB);
+    update(myLinenum, linenum, SF_JOB);
+}
+
+void store_fro(override_percent_t fro) {
+    update(myFro, fro, SF_OVERRIDES);
+}
+
+void store_motion(int planner_avail, uint32_t feedrate) {
+    update(myPlannerAvail, planner_avail, SF_MOTION);
+    update(myFeedrate, feedrate, SF_MOTION);
+}
+
+void store_modes(const char* modes) {
+    if (myModeString != modes) {
+        myModeString = modes;
+        mark(SF_MODES);
+    }
+}
+
+void store_alarm(int alarm) {
+    // Always marked, since the same alarm can be raised again
+    lastAlarm = alarm;
+    mark(SF_ALARM);
+}
+
+void store_error(int error) {
+    // Always marked, since a repeated error is shown again
+    lastError     = error;
+    errorExpire   = millis() + ERROR_SHOW_MS;
+    error_showing = true;
+    mark(SF_ERROR);
+}
+
+void store_report() {
+    mark(SF_REPORT);
+}
+
+void state_publish() {
+    if (error_showing) {
+        int32_t left = errorExpire - millis();
+        if (left <= 0) {
+            error_showing = false;
+            mark(SF_ERROR);
+        } else {
+            event_wake_within(left);
+        }
+    }
+    if (!changed) {
+        return;
+    }
+    uint16_t fields = changed;
+    changed         = 0;
+    for (auto& s : subscribers) {
+        if (s.listener && (s.fields & fields)) {
+            s.listener(fields & s.fields, s.arg);
+        }
+    }
+    if (current_scene) {
+        current_scene->onStateFields(fields);
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Change tracking for the machine state in FluidNCModel.  The values
+// stay in the model variables that scenes read (state, myAxes, myFro
+// ...), but they are written only through the store_ functions below,
+// which note which group of fields actually changed.  Once per pass,
+// state_publish() tells each subscriber about the groups it asked for,
+// and then tells the current scene through Scene::onStateFields().
+// Subscribers that are not scenes, such as loggers or a buzzer, are
+// called whatever scene is showing and do not cause redraws.
+
+#pragma once
+#include <Arduino.h>
+#include "FluidNCModel.h"
+
+enum state_field_t : uint16_t {
+    SF_STATE     = 1 << 0,  // state, stateString
+    SF_POSITION  = 1 << 1,  // myAxes
+    SF_SWITCHES  = 1 << 2,  // myLimitSwitches, myProbeSwitch
+    SF_JOB       = 1 << 3,  // myPercent, myLinenum
+    SF_OVERRIDES = 1 << 4,  // myFro
+    SF_MOTION    = 1 << 5,  // myPlannerAvail, myFeedrate
+    SF_MODES     = 1 << 6,  // myModeString
+    SF_ALARM     = 1 << 7,  // lastAlarm
+    SF_ERROR     = 1 << 8,  // lastError, and when it stops showing
+    SF_REPORT    = 1 << 9,  // A status report arrived, changed or not
+    SF_NFIELDS   = 10,
+};
+
+// Fields shown by the DRO and status areas of most scenes
+constexpr static const uint16_t SF_STATUS = SF_STATE | SF_POSITION | SF_SWITCHES | SF_JOB | SF_OVERRIDES;
+
+typedef void (*state_listener_t)(uint16_t changed, void* arg);
+
+// Returns an id for state_unsubscribe(), or -1 if there is no room
+int  state_subscribe(uint16_t fields, state_listener_t listener, void* arg = nullptr);
+void state_unsubscribe(int id);
+
+// How many times a field has changed since boot
+uint32_t state_version(state_field_t field);
+
+// Called by the model as it applies data from FluidNC
+void store_state(const char* state_string);
+void store_disconnected();
+void store_axes(const pos_t* axes, size_t n_axis);
+void store_switches(const bool* limits, size_t n_axis, bool probe);
+void store_job(file_percent_t percent, int linenum);
+void store_fro(override_percent_t fro);
+void store_motion(int planner_avail, uint32_t feedrate);
+void store_modes(const char* modes);
+void store_alarm(int alarm);
+void store_error(int error);
+void store_report();
+
+// Notify the subscribers and the current scene of what changed
+void state_publish();
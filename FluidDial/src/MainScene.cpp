@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
 
 extern Scene probingScene;
 extern Scene homingScene;
@@ -30,6 +31,9 @@ public:
         fnc_realtime(StatusReport);  // sometimes you want an extra status
     }
 
+    realtime_cmd_t redFastAction() override { return (state == Cycle || state == Homing || state == Hold) ? Reset : None; }
+    realtime_cmd_t greenFastAction() override { return state == Cycle ? FeedHold : None; }
+
     void onRedButtonPress() {
         switch (state) {
             case Alarm:
@@ -78,7 +82,6 @@ public:
     void onLimitsChange() { display(); }
 
     void display() {
-        canvas.createSprite(240, 240);
         drawBackground(BLACK);
         drawMenuTitle(current_scene->name());
         drawStatus();
@@ -100,12 +103,14 @@ public:
             }
 
             // Feed override
-            centered_text("Feed Rate Ovr:" + String(myFro) + "%", y + 23);
+            StackBuf<24> fro("Feed Rate Ovr:");
+            fro.addInt(myFro).add('%');
+            centered_text(fro, y + 23);
         }
 
-        String encoder_button_text = "Menu";
-        String redButtonText       = "";
-        String greenButtonText     = "";
+        const char* encoder_button_text = "Menu";
+        const char* redButtonText       = "";
+        const char* greenButtonText     = "";
         switch (state) {
             case Alarm:
                 drawButtonLegends("Reset", "Home All", encoder_button_text);
@@ -0,0 +1,144 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "MpgJog.h"
+#include "FluidNCModel.h"  // send_line()
+#include "FNCIngest.h"     // cancel_jogs()
+#include "Format.h"        // CommandBuf
+#include "EventLoop.h"     // event_wake_within()
+
+#include <algorithm>
+
+constexpr static const int WINDOW_MS  = 40;   // Detents collected into one jog
+constexpr static const int STOP_MS    = 150;  // The hand has stopped if no detents for this long
+constexpr static const int HOLDOFF_MS = 100;  // For FluidNC to flush its planner after a JogCancel
+constexpr static const int AHEAD_MS   = 250;  // Most motion to queue ahead of the hand
+
+// Gain on the increment, from the speed of the dial in detents/sec
+constexpr static const float SLOW_DETENTS = 5;   // Up to here each detent is one increment
+constexpr static const float FAST_DETENTS = 50;  // The gain is MAX_GAIN from here up
+constexpr static const float MAX_GAIN     = 10;
+
+void MpgJog::setup(int axis, float increment, int rate) {
+    if (axis != _axis) {
+        cancel();
+    }
+    _axis      = axis;
+    _increment = increment;
+    _rate      = rate;
+}
+
+float MpgJog::gain(float detents_per_sec) {
+    if (detents_per_sec <= SLOW_DETENTS) {
+        return 1;
+    }
+    if (detents_per_sec >= FAST_DETENTS) {
+        return MAX_GAIN;
+    }
+    return 1 + (MAX_GAIN - 1) * (detents_per_sec - SLOW_DETENTS) / (FAST_DETENTS - SLOW_DETENTS);
+}
+
+// Take off the motion that has probably happened since the last update
+void MpgJog::drain(uint32_t now) {
+    if (_queued > 0) {
+        _queued = std::max(_queued - _queued_feed * (now - _queued_time) / 60000, 0.0f);
+    }
+    _queued_time = now;
+}
+
+void MpgJog::detents(int delta, uint32_t time_us) {
+    uint32_t now = millis();
+    drain(now);
+
+    int dir = delta > 0 ? 1 : -1;
+    if (_queued > 0 && dir != _dir) {
+        // Stop what is left before going the other way
+        cancel();
+    } else if (_pending && (_pending > 0) != (delta > 0)) {
+        _pending = 0;
+        _scaled  = 0;
+    }
+
+    // The speed from the time since the last detent, as in
+    // Scene::scale_encoder(), so one click after a pause has gain 1
+    uint32_t dt = time_us - _last_us;
+    if (dir != _last_dir || dt > STOP_MS * 1000) {
+        _speed = 0;
+    } else {
+        _speed = (_speed + abs(delta) * 1e6f / std::max(dt, 1000u)) / 2;
+    }
+    _last_us  = time_us;
+    _last_dir = dir;
+
+    if (!_pending) {
+        _window_end = now + WINDOW_MS;
+    }
+    _pending += delta;
+    _scaled += abs(delta) * gain(_speed);
+    _last_detent = now;
+    event_wake_within(WINDOW_MS);
+}
+
+void MpgJog::send(uint32_t now) {
+    int   dir      = _pending > 0 ? 1 : -1;
+    float distance = _scaled * _increment;
+
+    // Fast enough to finish about when the next window's jog arrives
+    float feed = std::max((float)_rate, distance * 60000 / WINDOW_MS);
+
+    // One detent's move is always allowed, however slow the rate
+    float limit = std::max(feed * AHEAD_MS / 60000, _increment);
+    distance    = std::min(distance, limit - _queued);
+    if (distance < 0.001f) {
+        _pending = 0;  // Far enough ahead already, so these detents are dropped
+        _scaled  = 0;
+        return;
+    }
+
+    // $J=G91F1000X1.250
+    CommandBuf cmd("$J=G91");
+    cmd.word('F', (int32_t)feed).word(axisChar(_axis), dir * distance, 3);
+    if (!send_line(cmd)) {
+        // The link is busy, so these detents join the next window's jog
+        _window_end = now + WINDOW_MS;
+        event_wake_within(WINDOW_MS);
+        return;
+    }
+    _pending = 0;
+    _scaled  = 0;
+
+    _queued += distance;
+    _queued_feed = feed;
+    _dir         = dir;
+}
+
+void MpgJog::poll() {
+    uint32_t now = millis();
+    drain(now);
+
+    if (_pending) {
+        int32_t wait = std::max((int32_t)(_window_end - now), (int32_t)(_holdoff_end - now));
+        if (wait > 0) {
+            event_wake_within(wait);
+            return;
+        }
+        send(now);
+    }
+    if (_queued > 0) {
+        if (_queued > _increment && (int32_t)(now - _last_detent) >= STOP_MS) {
+            cancel();
+        } else {
+            event_wake_within(STOP_MS);
+        }
+    }
+}
+
+void MpgJog::cancel() {
+    if (_queued > 0) {
+        cancel_jogs();
+        _holdoff_end = millis() + HOLDOFF_MS;
+    }
+    _queued  = 0;
+    _pending = 0;
+    _scaled  = 0;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Hand-wheel jogging.  Encoder detents are collected for a short window
+// and sent as one jog move, whose distance grows faster than the
+// number of detents when the dial is spun quickly.  The motion queued
+// in FluidNC is kept to a fraction of a second ahead of the hand, and
+// is cancelled when the dial reverses or stops, so the machine does
+// not keep moving after the operator lets go.
+
+#pragma once
+#include <Arduino.h>
+
+class MpgJog {
+private:
+    int      _axis      = 0;
+    float    _increment = 0.1f;  // mm per detent at slow speed
+    int      _rate      = 1000;  // mm/min at slow speed
+    int      _pending   = 0;     // Detents not yet sent
+    float    _scaled    = 0;     // Increments for them, after the gain
+    float    _speed     = 0;     // Detents/sec, smoothed
+    uint32_t _last_us   = 0;     // Encoder time of the last detent
+    int      _last_dir  = 0;
+    uint32_t _window_end;        // When to send the pending detents
+    uint32_t _last_detent;       // For noticing that the dial stopped
+    uint32_t _holdoff_end = 0;   // No jogs until a cancel has taken effect
+    int      _dir         = 0;   // Direction of the motion in FluidNC
+    float    _queued      = 0;   // mm probably still to move
+    float    _queued_feed = 0;   // mm/min of that motion
+    uint32_t _queued_time = 0;   // When _queued was last updated
+
+    void  drain(uint32_t now);
+    void  send(uint32_t now);
+    float gain(float detents_per_sec);
+
+public:
+    // The selected axis and the scene's increment and rate
+    void setup(int axis, float increment, int rate);
+
+    void detents(int delta, uint32_t time_us);  // From onEncoder(), with encoderTime()
+    void poll();                                // From onTick()
+    void cancel();
+    bool active() { return _pending || _queued > 0; }
+};
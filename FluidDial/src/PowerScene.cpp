@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "MachineState.h"
 #include <driver/rtc_io.h>
 
 // The M5 Library is broken with respect to deep sleep on M5 Dial
@@ -17,6 +18,7 @@
 #define WAKEUP_GPIO (gpio_num_t) RED_BUTTON_PIN
 
 void deep_sleep(int us) {
+    flush_prefs();
     M5.Display.sleep();
     rtc_gpio_pullup_en(WAKEUP_GPIO);
     esp_sleep_enable_ext0_wakeup(WAKEUP_GPIO, false);
@@ -37,7 +39,7 @@ public:
     PowerScene() : Scene("Power") {}
     void onEntry() { log_println("Power init"); }
     void onRedButtonPress() {
-        set_disconnected_state();
+        store_disconnected();
         deep_sleep(0);
     }
     void reDisplay() {
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
 
 class ProbingScene : public Scene {
 private:
@@ -17,17 +18,15 @@ private:
     int   _axis    = 2;  // Z is default
 
 public:
-    ProbingScene() : Scene("Probe") {}
+    ProbingScene() : Scene("Probe") { setEncoderAcceleration(10); }
 
     void onDialButtonPress() { pop_scene(); }
 
     void onGreenButtonPress() {
         // G38.2 G91 F80 Z-20 P8.00
         if (state == Idle) {
-            String gcode = "G38.2G91";
-            gcode += "F" + floatToString(_rate, 0);
-            gcode += axisNumToString(_axis) + floatToString(_travel, 0);
-            gcode += "P" + floatToString(_offset, 2);
+            CommandBuf gcode("G38.2G91");
+            gcode.word('F', _rate, 0).word(axisChar(_axis), _travel, 0).word('P', _offset, 2);
             log_println(gcode);
             send_line(gcode);
             return;
@@ -42,6 +41,9 @@ public:
         }
     }
 
+    realtime_cmd_t redFastAction() override { return (state == Cycle || state == Hold) ? Reset : None; }
+    realtime_cmd_t greenFastAction() override { return state == Cycle ? FeedHold : None; }
+
     void onRedButtonPress() {
         // G38.2 G91 F80 Z-20 P8.00
         if (state == Cycle || state == Alarm) {
@@ -49,10 +51,10 @@ public:
             //send_line("$X");
             return;
         } else if (state == Idle) {
-            String gcode = "$J=G91F1000";
-            gcode += axisNumToString(_axis);
-            gcode += (_travel < 0) ? "+" : "-";  // retract is opposite travel
-            gcode += floatToString(_retract, 0);
+            CommandBuf gcode("$J=G91F1000");
+            gcode.add(axisChar(_axis));
+            gcode.add((_travel < 0) ? '+' : '-');  // retract is opposite travel
+            gcode.addFixed(_retract, 0);
             send_line(gcode);
             return;
         } else if (state == Hold) {
@@ -67,7 +69,15 @@ public:
         ackBeep();
     }
 
-    void onDROChange() { reDisplay(); }
+    void onDROChange() { redrawIfChanged(); }
+
+    void hashInputs(FrameHash& hash) override {
+        hashStatus(hash);
+        for (int axis = 0; axis < 3; axis++) {
+            DRO::hash(hash, axis);
+        }
+        hash.add(myProbeSwitch).add(_axis);
+    }
 
     void onEncoder(int delta) {
         if (abs(delta) > 0) {
@@ -116,7 +126,8 @@ public:
         drawMenuTitle(current_scene->name());
         drawStatus();
 
-        String grnText, redText;
+        const char* grnText = "";
+        const char* redText = "";
 
         if (state == Idle) {
             int    x      = 40;
@@ -125,13 +136,13 @@ public:
             int    height = 25;
             int    pitch  = 27;  // for spacing of buttons
             Stripe button(x, y, width, height, TINY);
-            button.draw("Offset", floatToString(_offset, 2), selection == 0);
-            button.draw("Max Travel", floatToString(_travel, 0), selection == 1);
+            button.draw("Offset", Fixed(_offset, 2), selection == 0);
+            button.draw("Max Travel", Fixed(_travel, 0), selection == 1);
             y = button.y();  // For LED
-            button.draw("Feed Rate", floatToString(_rate, 0), selection == 2);
+            button.draw("Feed Rate", Fixed(_rate, 0), selection == 2);
 
-            button.draw("Retract", floatToString(_retract, 0), selection == 3);
-            button.draw("Axis", axisNumToString(_axis), selection == 4);
+            button.draw("Retract", Fixed(_retract, 0), selection == 3);
+            button.draw("Axis", AxisName(_axis), selection == 4);
 
             //LED led(x - 20, y + height / 2, 10, button.gap());
             //led.draw(myProbeSwitch);
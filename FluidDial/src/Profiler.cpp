@@ -0,0 +1,196 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Profiler.h"
+#include "System.h"
+#include "EventLoop.h"
+#include <algorithm>
+#include <atomic>
+
+// Each phase keeps a ring of its most recent samples.  min/avg/max
+// are accumulated over fixed intervals, and the last complete interval
+// is what is reported and shown; p99 is computed from the ring.
+constexpr static const int PROFILE_SAMPLES = 128;
+constexpr static const int INTERVAL_MS     = 5000;
+
+struct interval_data {
+    uint32_t count    = 0;
+    uint64_t total_us = 0;
+    uint32_t min_us   = UINT32_MAX;
+    uint32_t max_us   = 0;
+    uint32_t allocs   = 0;
+};
+
+struct phase_data {
+    uint32_t      start_ccount = 0;
+    uint32_t      start_allocs = 0;
+    bool          running      = false;
+    uint32_t      samples[PROFILE_SAMPLES];
+    int           next_sample = 0;
+    int           n_samples   = 0;
+    interval_data current;  // Being accumulated
+    interval_data last;     // The last complete interval
+};
+
+static phase_data phases[PROF_NPHASES];
+
+static uint32_t loop_count       = 0;
+static uint32_t loops_per_second = 0;
+static uint32_t next_second_ms   = 0;
+static bool     streaming        = false;
+static uint32_t next_interval_ms = 0;
+static bool     have_interval    = false;  // Until then, current is shown
+
+static const char* phase_names[PROF_NPHASES] = { "dispatch", "poll", "compose", "push", "loop" };
+
+// Every malloc(), calloc() and realloc() - including those behind
+// operator new and String - is counted.  The linker redirects them
+// here via the --wrap options in platformio.ini.
+static std::atomic<uint32_t> alloc_count(0);
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    ++alloc_count;
+    return __real_malloc(size);
+}
+void* __wrap_calloc(size_t n, size_t size) {
+    ++alloc_count;
+    return __real_calloc(n, size);
+}
+void* __wrap_realloc(void* ptr, size_t size) {
+    ++alloc_count;
+    return __real_realloc(ptr, size);
+}
+}
+
+uint32_t profile_alloc_count() {
+    return alloc_count;
+}
+
+static inline uint32_t ccount_to_us(uint32_t cycles) {
+    return cycles / ESP.getCpuFreqMHz();
+}
+
+void profile_begin(profile_phase_t phase) {
+    auto& p        = phases[phase];
+    p.start_allocs = alloc_count;
+    p.start_ccount = ESP.getCycleCount();
+    p.running      = true;
+}
+
+void profile_end(profile_phase_t phase) {
+    auto& p = phases[phase];
+    if (!p.running) {
+        return;  // e.g. a redraw that did not start with drawBackground()
+    }
+    p.running   = false;
+    uint32_t us = ccount_to_us(ESP.getCycleCount() - p.start_ccount);
+
+    p.samples[p.next_sample] = us;
+    p.next_sample            = (p.next_sample + 1) % PROFILE_SAMPLES;
+    if (p.n_samples < PROFILE_SAMPLES) {
+        ++p.n_samples;
+    }
+    auto& c = p.current;
+    ++c.count;
+    c.total_us += us;
+    c.min_us = std::min(c.min_us, us);
+    c.max_us = std::max(c.max_us, us);
+    c.allocs += alloc_count - p.start_allocs;
+}
+
+void profile_loop_tick() {
+    ++loop_count;
+    uint32_t now = millis();
+    if ((int32_t)(now - next_second_ms) >= 0) {
+        loops_per_second = loop_count;
+        loop_count       = 0;
+        next_second_ms   = now + 1000;
+    }
+}
+
+const char* profile_phase_name(profile_phase_t phase) {
+    return phase_names[phase];
+}
+
+void profile_get_stats(profile_phase_t phase, profile_stats_t& stats) {
+    auto& p      = phases[phase];
+    auto& i      = have_interval ? p.last : p.current;
+    stats.count  = i.count;
+    stats.min_us = i.count ? i.min_us : 0;
+    stats.avg_us = i.count ? i.total_us / i.count : 0;
+    stats.max_us = i.max_us;
+    stats.allocs = i.allocs;
+
+    if (p.n_samples == 0) {
+        stats.p99_us = 0;
+        return;
+    }
+    uint32_t sorted[PROFILE_SAMPLES];
+    memcpy(sorted, p.samples, p.n_samples * sizeof(*sorted));
+    std::sort(sorted, sorted + p.n_samples);
+    stats.p99_us = sorted[(p.n_samples * 99) / 100];
+}
+
+uint32_t profile_loops_per_second() {
+    return loops_per_second;
+}
+
+void profile_set_streaming(bool on) {
+    streaming = on;
+}
+bool profile_streaming() {
+    return streaming;
+}
+
+void profile_report() {
+    char buf[120];
+    snprintf(buf,
+             sizeof(buf),
+             "Profile: %u loops/s, %u wakes, %u allocs total (min/avg/p99/max us)",
+             loops_per_second,
+             event_wake_count(),
+             profile_alloc_count());
+    log_println(buf);
+    for (int i = 0; i < PROF_NPHASES; i++) {
+        profile_stats_t stats;
+        profile_get_stats((profile_phase_t)i, stats);
+        snprintf(buf,
+                 sizeof(buf),
+                 "  %-8s n=%u %u/%u/%u/%u allocs=%u",
+                 phase_names[i],
+                 stats.count,
+                 stats.min_us,
+                 stats.avg_us,
+                 stats.p99_us,
+                 stats.max_us,
+                 stats.allocs);
+        log_println(buf);
+    }
+}
+
+// Intervals roll over whether or not they are streamed, so the Setup
+// overlay shows recent values rather than averages since boot
+void profile_poll() {
+    uint32_t now = millis();
+    if (!next_interval_ms) {
+        next_interval_ms = now + INTERVAL_MS;  // The first interval starts with the first loop
+        return;
+    }
+    if ((int32_t)(now - next_interval_ms) < 0) {
+        return;
+    }
+    next_interval_ms = now + INTERVAL_MS;
+    for (auto& p : phases) {
+        p.last    = p.current;
+        p.current = interval_data();
+    }
+    have_interval = true;
+    if (streaming) {
+        profile_report();
+    }
+}
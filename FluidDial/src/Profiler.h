@@ -0,0 +1,44 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Lightweight loop profiler using the CPU cycle counter
+
+#pragma once
+#include <Arduino.h>
+
+enum profile_phase_t {
+    PROF_DISPATCH = 0,  // dispatch_events(), including any redraws it causes
+    PROF_POLL,          // dispatch_fnc_events() applying parsed FluidNC data
+    PROF_COMPOSE,       // drawBackground() to refreshDisplay() in reDisplay()
+    PROF_PUSH,          // canvas.pushSprite()
+    PROF_LOOP,          // One whole pass through loop()
+    PROF_NPHASES,
+};
+
+struct profile_stats_t {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t allocs;  // Heap allocations made during the phase
+};
+
+void profile_begin(profile_phase_t phase);
+void profile_end(profile_phase_t phase);
+
+// Called once per loop() pass
+void profile_loop_tick();
+
+const char* profile_phase_name(profile_phase_t phase);
+void        profile_get_stats(profile_phase_t phase, profile_stats_t& stats);
+uint32_t    profile_loops_per_second();
+
+// Heap allocations by any task since boot
+uint32_t profile_alloc_count();
+
+// Periodic streaming of the statistics to debugPort
+void profile_set_streaming(bool on);
+bool profile_streaming();
+void profile_report();
+void profile_poll();
@@ -0,0 +1,48 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Lock-free single-producer single-consumer ring buffer.
+// One task may call push() and one other task may call pop();
+// no locks are needed because each index has only one writer.
+
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SPSCRing {
+    static_assert((N & (N - 1)) == 0, "SPSCRing size must be a power of two");
+
+private:
+    T                   _items[N];
+    std::atomic<size_t> _head { 0 };  // Next slot to write, owned by the producer
+    std::atomic<size_t> _tail { 0 };  // Next slot to read, owned by the consumer
+
+public:
+    bool push(const T& item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            return false;  // Full
+        }
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail) {
+            return false;  // Empty
+        }
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Items in the ring.  The producer may count one that has just been
+    // taken, and the consumer may miss one that has just been added.
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+    bool full() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire) == N; }
+};
@@ -2,7 +2,13 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include <Arduino.h>
+#include <algorithm>
 #include "Scene.h"
+#include "Format.h"
+#include "InputEvents.h"
+#include "JogLatency.h"
+#include "EventLoop.h"
+#include "MachineState.h"
 
 Scene* current_scene = nullptr;
 
@@ -15,6 +21,7 @@ std::vector<Scene*> scene_stack;
 void activate_scene(Scene* scene, void* arg) {
     if (current_scene) {
         current_scene->onExit();
+        current_scene->flushPrefs();
     }
     current_scene = scene;
     current_scene->onEntry(arg);
@@ -36,135 +43,292 @@ void activate_at_top_level(Scene* scene, void* arg) {
     activate_scene(scene, arg);
 }
 
-void dispatch_events() {
-    static m5::touch_state_t last_touch_state = {};
+void Scene::onStateFields(uint16_t changed) {
+    if (changed & SF_STATE) {
+        onStateChange(state);
+    }
+    if (changed & SF_SWITCHES) {
+        onLimitsChange();
+    }
+    if (changed & SF_STATUS) {
+        onDROChange();
+    }
+    if (changed & (SF_MODES | SF_ALARM | SF_ERROR)) {
+        reDisplay();
+    }
+}
+
+static Button& input_button(uint8_t which) {
+    return which == IN_RED ? redButton : which == IN_GREEN ? greenButton : dialButton;
+}
+
+static void dispatch_input(const input_event_t& event) {
+    switch (event.type) {
+        case IN_ENCODER: {
+            int scaledDelta = current_scene->scale_encoder(event.delta, event.time_us);
+            if (scaledDelta) {
+                jog_latency_detent(event.time_us);
+                current_scene->onEncoder(scaledDelta);
+            }
+            break;
+        }
+        case IN_BUTTON_PRESS:
+            // A replayed press has no fast path to share it with
+            if (!input_replaying() && !input_button(event.button).claim()) {
+                break;
+            }
+            switch (event.button) {
+                case IN_DIAL:
+                    current_scene->onDialButtonPress();
+                    break;
+                case IN_RED:
+                    current_scene->onRedButtonPress();
+                    break;
+                case IN_GREEN:
+                    current_scene->onGreenButtonPress();
+                    break;
+            }
+            break;
+        case IN_BUTTON_RELEASE:
+            switch (event.button) {
+                case IN_DIAL:
+                    current_scene->onDialButtonRelease();
+                    break;
+                case IN_RED:
+                    current_scene->onRedButtonRelease();
+                    break;
+                case IN_GREEN:
+                    current_scene->onGreenButtonRelease();
+                    break;
+            }
+            break;
+        case IN_TOUCH_PRESS:
+            current_scene->onTouchPress(event.x, event.y);
+            break;
+        case IN_TOUCH_RELEASE:
+            current_scene->onTouchRelease(event.x, event.y);
+            break;
+        case IN_TOUCH_HOLD:
+            current_scene->onTouchHold(event.x, event.y);
+            break;
+        case IN_TOUCH_FLICK:
+            current_scene->onTouchFlick(event.x, event.y, event.dx, event.dy);
+            break;
+        default:
+            break;
+    }
+}
 
+void dispatch_events() {
     M5Dial.update();
 
-    static int16_t oldEncoder   = 0;
-    int16_t        newEncoder   = get_encoder();
-    int16_t        encoderDelta = newEncoder - oldEncoder;
-    if (encoderDelta) {
-        oldEncoder = newEncoder;
+    // What the fast path should do if a button is pressed before the next pass
+    redButton.arm(current_scene->redFastAction());
+    greenButton.arm(current_scene->greenFastAction());
 
-        int16_t scaledDelta = current_scene->scale_encoder(encoderDelta);
-        if (scaledDelta) {
-            current_scene->onEncoder(scaledDelta);
-        }
+    collect_inputs();
+    input_event_t event;
+    while (next_input(event)) {
+        dispatch_input(event);
     }
+    current_scene->onTick();
+    current_scene->pollPrefs();
 
-    bool this_button;
-    if (dialButton.changed(this_button)) {
-        if (this_button) {
-            current_scene->onDialButtonPress();
-        } else {
-            current_scene->onDialButtonRelease();
+    if (!fnc_is_connected()) {
+        if (state != Disconnected) {
+            store_disconnected();
+            extern Scene menuScene;
+            activate_at_top_level(&menuScene);
         }
     }
+}
+
+// Idle time after the last change before the preferences are written
+constexpr static const int PREF_IDLE_MS = 5000;
 
-    if (redButton.changed(this_button)) {
-        if (this_button) {
-            current_scene->onRedButtonPress();
-        } else {
-            current_scene->onRedButtonRelease();
+static uint32_t pref_flash_writes = 0;  // nvs_set_i32() calls made
+static uint32_t pref_writes_saved = 0;  // setPref() calls that did not need one
+
+Scene::pref_entry* Scene::findPref(const char* name) {
+    for (auto& entry : _pref_cache) {
+        if (strcmp(entry.name, name) == 0) {
+            return &entry;
         }
     }
+    return nullptr;
+}
 
-    if (greenButton.changed(this_button)) {
-        if (this_button) {
-            current_scene->onGreenButtonPress();
-        } else {
-            current_scene->onGreenButtonRelease();
-        }
+void Scene::storePref(const char* name, int32_t value) {
+    if (!_prefs) {
+        return;
     }
+    pref_entry* entry = findPref(name);
+    if (entry && (entry->dirty || entry->value == value)) {
+        // Unchanged, or replacing a value that has not been written yet
+        ++pref_writes_saved;
+    }
+    if (entry && entry->value == value) {
+        return;
+    }
+    if (!entry) {
+        _pref_cache.push_back({});
+        entry = &_pref_cache.back();
+        strncpy(entry->name, name, sizeof(entry->name) - 1);
+    }
+    entry->value     = value;
+    entry->dirty     = true;
+    _pref_dirty      = true;
+    _pref_changed_ms = millis();
+}
 
-    auto this_touch = touch.getDetail();
-    if (this_touch.state != last_touch_state) {
-        last_touch_state = this_touch.state;
-        // debugPort.printf("Touch %d\r\n", this_touch.state);
-        if (this_touch.state == m5::touch_state_t::touch) {
-            //speaker.tone(1800, 50);
-            current_scene->onTouchPress(this_touch.x, this_touch.y);
-        } else if (this_touch.wasClicked()) {
-            current_scene->onTouchRelease(this_touch.x, this_touch.y);
-        } else if (this_touch.wasHold()) {
-            current_scene->onTouchHold(this_touch.x, this_touch.y);
-        } else if (this_touch.state == m5::touch_state_t::flick_end) {
-            current_scene->onTouchFlick(this_touch.x, this_touch.y, this_touch.distanceX(), this_touch.distanceY());
+bool Scene::loadPref(const char* name, int32_t* value) {
+    if (!_prefs) {
+        return false;
+    }
+    pref_entry* entry = findPref(name);
+    if (!entry) {
+        int32_t stored;
+        if (nvs_get_i32(_prefs, name, &stored) != ESP_OK) {
+            return false;
         }
+        _pref_cache.push_back({});
+        entry = &_pref_cache.back();
+        strncpy(entry->name, name, sizeof(entry->name) - 1);
+        entry->value = stored;
     }
+    *value = entry->value;
+    return true;
+}
 
-    if (!fnc_is_connected()) {
-        if (state != Disconnected) {
-            set_disconnected_state();
-            extern Scene menuScene;
-            activate_at_top_level(&menuScene);
+void Scene::flushPrefs() {
+    if (!_pref_dirty) {
+        return;
+    }
+    for (auto& entry : _pref_cache) {
+        if (entry.dirty) {
+            nvs_set_i32(_prefs, entry.name, entry.value);
+            entry.dirty = false;
+            ++pref_flash_writes;
         }
     }
+    nvs_commit(_prefs);
+    _pref_dirty = false;
 }
 
-void Scene::setPref(const char* name, int value) {
-    if (!_prefs) {
+void Scene::pollPrefs() {
+    if (!_pref_dirty) {
         return;
     }
-    nvs_set_i32(_prefs, name, value);
+    int32_t wait = PREF_IDLE_MS - (int32_t)(millis() - _pref_changed_ms);
+    if (wait <= 0) {
+        flushPrefs();
+    } else {
+        event_wake_within(wait);
+    }
+}
+
+void flush_prefs() {
+    if (current_scene) {
+        current_scene->flushPrefs();
+    }
+}
+
+void prefs_report() {
+    char buf[80];
+    snprintf(buf, sizeof(buf), "Prefs: %u flash writes, %u saved by the cache", pref_flash_writes, pref_writes_saved);
+    log_println(buf);
+}
+
+void Scene::setPref(const char* name, int value) {
+    storePref(name, value);
 }
 void Scene::getPref(const char* name, int* value) {
-    if (!_prefs) {
-        return;
+    int32_t stored;
+    if (loadPref(name, &stored)) {
+        *value = stored;
     }
-    nvs_get_i32(_prefs, name, value);
 }
 void Scene::setPref(const char* name, float value) {
-    if (!_prefs) {
-        return;
-    }
     union {
         int32_t i;
         float   f;
     } val;
     val.f = value;
-    nvs_set_i32(_prefs, name, val.i);
+    storePref(name, val.i);
 }
 void Scene::getPref(const char* name, float* value) {
-    if (!_prefs) {
-        return;
-    }
     union {
         int32_t i;
         float   f;
     } val;
-
-    esp_err_t err = nvs_get_i32(_prefs, name, &val.i);
-    if (err == ESP_OK) {
+    if (loadPref(name, &val.i)) {
         *value = val.f;
     }
 }
 void Scene::setPref(const char* base_name, int axis, int value) {
-    if (!_prefs) {
-        return;
-    }
-    String setting_name = base_name + axisNumToString(axis);
-    nvs_set_i32(_prefs, setting_name.c_str(), value);
+    StackBuf<16> setting_name(base_name);
+    setting_name.add(axisChar(axis));
+    setPref(setting_name, value);
 }
 void Scene::getPref(const char* base_name, int axis, int* value) {
-    if (!_prefs) {
-        return;
-    }
-    String setting_name = base_name + axisNumToString(axis);
-    nvs_get_i32(_prefs, setting_name.c_str(), value);
+    StackBuf<16> setting_name(base_name);
+    setting_name.add(axisChar(axis));
+    getPref(setting_name, value);
 }
 bool Scene::initPrefs() {
     if (_prefs) {
         return false;  // Already open
     }
-    esp_err_t err = nvs_open(name().c_str(), NVS_READWRITE, &_prefs);
+    esp_err_t err = nvs_open(name(), NVS_READWRITE, &_prefs);
     return err == ESP_OK;
 }
 
-int Scene::scale_encoder(int delta) {
+void Scene::redrawIfChanged() {
+    FrameHash hash;
+    hashInputs(hash);
+    if (hash.value() != _frame_hash) {
+        reDisplay();
+    }
+}
+
+void Scene::frameDrawn() {
+    FrameHash hash;
+    hashInputs(hash);
+    _frame_hash = hash.value();
+}
+
+// Detent rates for the acceleration profile
+constexpr static const float ACCEL_SLOW_RATE = 8;   // Detents/sec below which each detent is one step
+constexpr static const float ACCEL_FAST_RATE = 40;  // Detents/sec at which the gain is the maximum
+constexpr static const int   ACCEL_PAUSE_US  = 250000;
+
+int Scene::scale_encoder(int delta, uint32_t time_us) {
+    _encoder_time_us = time_us;
     _encoder_accum += delta;
     int res = _encoder_accum / _encoder_scale;
     _encoder_accum %= _encoder_scale;
-    return res;
+    if (!res || _encoder_max_gain <= 1) {
+        return res;
+    }
+
+    // The rate from the time since the last detent, smoothed so one
+    // quick flick does not jump to the maximum
+    int      dir = res > 0 ? 1 : -1;
+    uint32_t dt  = time_us - _encoder_last_us;
+    if (dir != _encoder_last_dir || dt > ACCEL_PAUSE_US) {
+        _encoder_rate = 0;
+    } else {
+        float rate    = abs(res) * 1e6f / std::max(dt, 1000u);
+        _encoder_rate = (_encoder_rate + rate) / 2;
+    }
+    _encoder_last_us  = time_us;
+    _encoder_last_dir = dir;
+
+    float gain = 1;
+    if (_encoder_rate >= ACCEL_FAST_RATE) {
+        gain = _encoder_max_gain;
+    } else if (_encoder_rate > ACCEL_SLOW_RATE) {
+        gain = 1 + (_encoder_max_gain - 1) * (_encoder_rate - ACCEL_SLOW_RATE) / (ACCEL_FAST_RATE - ACCEL_SLOW_RATE);
+    }
+    return res * (int)lroundf(gain);
 }
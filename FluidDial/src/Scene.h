@@ -6,23 +6,56 @@
 #include "GrblParserC.h"
 #include "Button.h"
 #include "Drawing.h"
+#include "FrameHash.h"
 #include "nvs_flash.h"
+#include <vector>
 
 void pop_scene(void* arg = nullptr);
 
 class Scene {
 private:
-    String _name;
+    const char* _name;
 
     nvs_handle_t _prefs {};
 
+    // Preferences are read from NVS once and written back in batches by
+    // flushPrefs(), so turning the dial over a setting does not write
+    // flash on every detent
+    struct pref_entry {
+        char    name[16];  // NVS keys are at most 15 characters
+        int32_t value;
+        bool    dirty;
+    };
+    std::vector<pref_entry> _pref_cache;
+    uint32_t                _pref_changed_ms = 0;  // Last setPref() that made an entry dirty
+    bool                    _pref_dirty      = false;
+
+    pref_entry* findPref(const char* name);
+    void        storePref(const char* name, int32_t value);
+    bool        loadPref(const char* name, int32_t* value);
+
     int _encoder_accum = 0;
     int _encoder_scale = 1;
 
+    // Acceleration: steps per detent grow from 1 when turning slowly to
+    // _encoder_max_gain when spinning fast
+    int      _encoder_max_gain = 1;
+    float    _encoder_rate     = 0;  // Detents/sec, smoothed
+    uint32_t _encoder_last_us  = 0;
+    int      _encoder_last_dir = 0;
+    uint32_t _encoder_time_us  = 0;  // Of the encoder event being handled
+
+    uint32_t _frame_hash = 0;
+
 public:
     Scene(const char* name, int encoder_scale = 1) : _name(name), _encoder_scale(encoder_scale) {}
 
-    const String& name() { return _name; }
+    const char* name() { return _name; }
+
+    // Realtime commands for the button fast path to send on a press,
+    // for scenes where the red or green button is an E-Stop or Hold
+    virtual realtime_cmd_t redFastAction() { return None; }
+    virtual realtime_cmd_t greenFastAction() { return None; }
 
     virtual void onRedButtonPress() {}
     virtual void onRedButtonRelease() {}
@@ -39,21 +72,45 @@ public:
         }
     }
 
+    // The groups of fields in MachineState.h that changed since the last
+    // call.  By default this calls the handlers below.
+    virtual void onStateFields(uint16_t changed);
+
     virtual void onStateChange(state_t) {}
     virtual void onDROChange() {}
     virtual void onLimitsChange() {}
     virtual void onMessage(char* command, char* arguments) {}
     virtual void onEncoder(int delta) {}
+    // Every time through the loop, for scenes with timed work.  Use
+    // event_wake_within() to be sure of another call soon.
+    virtual void onTick() {}
     virtual void reDisplay() {}
+
+    // Scenes that redraw on every status report declare the values they
+    // draw here, and call redrawIfChanged() instead of reDisplay() so that
+    // frames identical to the one on the display are skipped.  Changes
+    // made by the scene itself should still call reDisplay() directly;
+    // refreshDisplay() records the hash of every frame, however drawn.
+    virtual void hashInputs(FrameHash& hash) {}
+    void         redrawIfChanged();
+    void         frameDrawn();
     virtual void onEntry(void* arg = nullptr) {}
     virtual void onExit() {}
 
     virtual void onFileLines() {}
     virtual void onFilesList() {}
+    virtual void onToolpath() {}
 
     bool initPrefs();
 
-    int scale_encoder(int delta);
+    // delta in encoder counts, at time_us
+    int scale_encoder(int delta, uint32_t time_us);
+
+    // When the encoder moved, for onEncoder() to measure the dial speed
+    uint32_t encoderTime() { return _encoder_time_us; }
+
+    // For lists and values with a large range; 1 turns acceleration off
+    void setEncoderAcceleration(int max_gain) { _encoder_max_gain = max_gain; }
 
     void setPref(const char* name, int value);
     void getPref(const char* name, int* value);
@@ -61,6 +118,11 @@ public:
     void getPref(const char* name, float* value);
     void setPref(const char* name, int axis, int value);
     void getPref(const char* name, int axis, int* value);
+
+    // Write the changed preferences to flash.  Done on scene exit, after
+    // the settings have been left alone for a while, and before sleeping.
+    void flushPrefs();
+    void pollPrefs();
 };
 
 void activate_at_top_level(Scene* scene, void* arg = nullptr);
@@ -93,3 +155,9 @@ extern Button redButton;
 extern Button dialButton;
 
 void dispatch_events();
+
+// Flush the current scene's preferences, e.g. before deep sleep
+void flush_prefs();
+
+// Flash writes made and avoided by the preference cache, to debugPort
+void prefs_report();
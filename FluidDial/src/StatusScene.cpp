@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Format.h"
+#include "JobEstimate.h"
 
 class StatusScene : public Scene {
 private:
@@ -17,6 +19,9 @@ public:
         fnc_realtime(StatusReport);  // sometimes you want an extra status
     }
 
+    realtime_cmd_t redFastAction() override { return (state == Cycle || state == Homing || state == Hold) ? Reset : None; }
+    realtime_cmd_t greenFastAction() override { return state == Cycle ? FeedHold : None; }
+
     void onRedButtonPress() {
         switch (state) {
             case Alarm:
@@ -60,15 +65,24 @@ public:
         }
     }
 
-    void onDROChange() { reDisplay(); }
-    void onLimitsChange() { reDisplay(); }
+    void onDROChange() { redrawIfChanged(); }
+    void onLimitsChange() { redrawIfChanged(); }
+
+    void hashInputs(FrameHash& hash) override {
+        hashStatus(hash);
+        for (int axis = 0; axis < 3; axis++) {
+            DRO::hash(hash, axis);
+        }
+        hash.add(myPercent).add(myLinenum).add(myFro);
+    }
 
     void reDisplay() {
         drawBackground(BLACK);
         drawMenuTitle(current_scene->name());
         drawStatus();
 
-        String grnText, redText = "";
+        const char* grnText = "";
+        const char* redText = "";
 
         DRO dro(10, 68, 220, 32);
         dro.draw(0, false);
@@ -86,11 +100,18 @@ public:
                     drawRect(20, y, width, height, 5, GREEN);
                 }
             }
-            // Feed override
-            centered_text("Feed Rate Ovr:" + String(myFro) + "%", y + 23);
+            // Feed override, and the time left if the job was estimated
+            float        remaining;
+            StackBuf<32> fro;
+            if (job_remaining(myLinenum, myPercent, remaining)) {
+                fro.add("Ovr:").addInt(myFro).add("%  Left ").addTime(remaining);
+            } else {
+                fro.add("Feed Rate Ovr:").addInt(myFro).add('%');
+            }
+            centered_text(fro, y + 23);
         }
 
-        String encoder_button_text = "Menu";
+        const char* encoder_button_text = "Menu";
 
         switch (state) {
             case Alarm:
@@ -2,6 +2,9 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include "System.h"
+#include "EventLoop.h"
+#include "Format.h"
+#include "GlyphAtlas.h"
 
 M5Canvas           canvas(&M5Dial.Display);
 M5GFX&             display = M5Dial.Display;
@@ -22,6 +25,16 @@ String M5TouchStateName(m5::touch_state_t state_num) {
 
 #define FORMAT_LITTLEFS_IF_FAILED true
 
+static void touch_isr() {
+    event_wake(EV_WAKE_TOUCH);
+}
+
+#ifdef CANVAS_8BIT
+static const lgfx::color_depth_t canvas_depth = lgfx::rgb332_1Byte;
+#else
+static const lgfx::color_depth_t canvas_depth = lgfx::rgb565_2Byte;
+#endif
+
 void init_system() {
     USBSerial.begin(921600);
 
@@ -31,13 +44,110 @@ void init_system() {
     // Don't enable the encoder because M5's encoder driver is flaky
     M5Dial.begin(cfg, false, false);
     touch.setFlickThresh(30);
+    attachInterrupt(TOUCH_INT_PIN, touch_isr, FALLING);
+
+    // Allocate the full-screen canvas once, before anything else can
+    // fragment the heap.  Scenes draw into it without recreating it.
+    canvas.setColorDepth(canvas_depth);
+    if (!canvas.createSprite(display.width(), display.height())) {
+        log_println("Canvas allocation failed");
+    }
+    init_glyph_atlas();
 
     if (!LittleFS.begin(FORMAT_LITTLEFS_IF_FAILED)) {
         log_println("LittleFS Mount Failed");
         return;
     }
+}
+
+struct pooled_sprite {
+    M5Canvas            sprite;
+    int                 width  = 0;
+    int                 height = 0;
+    lgfx::color_depth_t depth;
+    bool                in_use = false;
+};
+
+constexpr static const int SPRITE_POOL_SIZE = 2;  // The thumbnail, and one spare
+static pooled_sprite       sprite_pool[SPRITE_POOL_SIZE];
 
-    canvas.createSprite(display.width(), display.height());
+M5Canvas* get_sprite(int width, int height) {
+    return get_sprite(width, height, canvas_depth);
+}
+
+M5Canvas* get_sprite(int width, int height, lgfx::color_depth_t depth) {
+    // Prefer a free sprite that already has a framebuffer of the right size
+    for (auto& ps : sprite_pool) {
+        if (!ps.in_use && ps.width == width && ps.height == height && ps.depth == depth) {
+            ps.in_use = true;
+            return &ps.sprite;
+        }
+    }
+    // Otherwise allocate into an empty slot, or reallocate an idle one
+    pooled_sprite* victim = nullptr;
+    for (auto& ps : sprite_pool) {
+        if (!ps.in_use && (!victim || ps.width == 0)) {
+            victim = &ps;
+        }
+    }
+    if (!victim) {
+        log_println("Sprite pool exhausted");
+        return nullptr;
+    }
+    if (victim->width) {
+        victim->sprite.deleteSprite();
+    }
+    victim->sprite.setColorDepth(depth);
+    if (!victim->sprite.createSprite(width, height)) {
+        victim->width  = 0;
+        victim->height = 0;
+        log_println("Sprite allocation failed");
+        return nullptr;
+    }
+    victim->width  = width;
+    victim->height = height;
+    victim->depth  = depth;
+    victim->in_use = true;
+    return &victim->sprite;
+}
+
+void release_sprite(M5Canvas* sprite) {
+    for (auto& ps : sprite_pool) {
+        if (&ps.sprite == sprite) {
+            ps.in_use = false;
+            return;
+        }
+    }
+}
+
+void show_memory_usage() {
+    size_t pool_bytes = 0;
+    int    pool_count = 0;
+    for (auto& ps : sprite_pool) {
+        if (ps.width) {
+            pool_bytes += ps.sprite.bufferLength();
+            ++pool_count;
+        }
+    }
+
+    char buf[160];
+    snprintf(buf,
+             sizeof(buf),
+             "Heap free %u min %u largest %u, PSRAM free %u of %u",
+             ESP.getFreeHeap(),
+             ESP.getMinFreeHeap(),
+             ESP.getMaxAllocHeap(),
+             ESP.getFreePsram(),
+             ESP.getPsramSize());
+    log_println(buf);
+    snprintf(buf,
+             sizeof(buf),
+             "Canvas %d bpp %u bytes, sprite pool %d sprites %u bytes",
+             canvas.getColorDepth() & 0xff,
+             canvas.bufferLength(),
+             pool_count,
+             pool_bytes);
+    log_println(buf);
 }
 
 void log_write(uint8_t c) {
@@ -48,20 +158,34 @@ void log_write(uint8_t c) {
 #endif
 }
 
-void log_print(const String& s) {
+void log_print(const char* s) {
 #ifdef DEBUG_TO_FNC
-    extern void send_line(const String& s, int timeout = 2000);
-    send_line("$Msg/Uart0=" + s);
+    extern bool send_line(const char* s, int timeout = 2000);
+    CommandBuf msg("$Msg/Uart0=");
+    msg.add(s);
+    send_line(msg);
 #endif
 #ifdef DEBUG_TO_USB
-    if (debugPort.availableForWrite() > s.length()) {
+    if (debugPort.availableForWrite() > strlen(s)) {
         debugPort.print(s);
     }
 #endif
 }
 
+void log_println(const char* s) {
+    // One piece, so DEBUG_TO_FNC sends one $Msg line
+    StackBuf<256> line(s);
+    line.truncate(256 - 3);  // Room for the line ending
+    line.add("\r\n");
+    log_print(line.c_str());
+}
+
+void log_print(const String& s) {
+    log_print(s.c_str());
+}
+
 void log_println(const String& s) {
-    log_print(s + "\r\n");
+    log_println(s.c_str());
 }
 
 void ackBeep() {
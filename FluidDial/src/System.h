@@ -7,6 +7,12 @@
 #define DEBUG_TO_USB
 #define ECHO_FNC_TO_DEBUG
 
+// Compose the display in RGB332 instead of RGB565.  That halves the
+// canvas RAM and the bytes touched while drawing; pushSprite() expands
+// it to the panel's format.  The UI's flat colors come through, but
+// colors in PNG images are coarser.
+// #define CANVAS_8BIT
+
 #include <Arduino.h>
 #include <LittleFS.h>
 #include "M5Dial.h"
@@ -37,7 +43,9 @@ constexpr static const int FNC_TX_PIN       = GPIO_NUM_13;
 #endif
 
 constexpr static const int DIAL_BUTTON_PIN = GPIO_NUM_42;
+constexpr static const int TOUCH_INT_PIN   = GPIO_NUM_14;  // FT3267 interrupt, active low
 constexpr static const int UPDATE_RATE_MS  = 30;  // minimum refresh rate in milliseconds
+constexpr static const int IDLE_WAKE_MS    = 250;  // longest sleep when nothing is happening
 
 extern M5Canvas           canvas;
 extern M5GFX&             display;
@@ -52,9 +60,22 @@ String M5TouchStateName(m5::touch_state_t state_num);
 
 void init_system();
 
+// Sprite pool.  The full-screen canvas is allocated once in init_system()
+// and reused for every redraw.  Images that outlive a redraw, such as the
+// toolpath thumbnail, are borrowed with get_sprite() and returned with
+// release_sprite(); a released sprite keeps its framebuffer so the next
+// borrow of the same size and depth does no allocation.  Widgets like the
+// DRO stripes draw straight into the canvas, which needs no sprite.
+M5Canvas* get_sprite(int width, int height);  // At the depth of the canvas
+M5Canvas* get_sprite(int width, int height, lgfx::color_depth_t depth);
+void      release_sprite(M5Canvas* sprite);
+void      show_memory_usage();
+
 void ackBeep();
 
 void log_write(uint8_t c);
+void log_print(const char* s);
+void log_println(const char* s);
 void log_print(const String& s);
 void log_println(const String& s);
 
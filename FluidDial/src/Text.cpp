@@ -2,6 +2,8 @@
 // Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
 
 #include "Text.h"
+#include "Format.h"
+#include "GlyphAtlas.h"
 #include <map>
 
 const GFXfont* font[] = {
@@ -13,30 +15,30 @@ const GFXfont* font[] = {
     &fonts::FreeMonoBold18pt7b,  // MEDIUM_MONO
 };
 
-void text(const String& msg, int x, int y, int color, fontnum_t fontnum, int datum) {
+void text(const char* msg, int x, int y, int color, fontnum_t fontnum, int datum) {
+    if (atlas_text(msg, x, y, color, fontnum, datum)) {
+        return;
+    }
     canvas.setFont(font[fontnum]);
     canvas.setTextDatum(datum);
     canvas.setTextColor(color);
     canvas.drawString(msg, x, y);
 }
 
-void text(const String& msg, Point xy, int color, fontnum_t fontnum, int datum) {
+void text(const char* msg, Point xy, int color, fontnum_t fontnum, int datum) {
     Point dispxy = xy.to_display();
     text(msg, dispxy.x, dispxy.y, color, fontnum, datum);
 }
 
-void centered_text(const String& msg, int y, int color, fontnum_t fontnum) {
+void centered_text(const char* msg, int y, int color, fontnum_t fontnum) {
     text(msg, display.width() / 2, y, color, fontnum);
 }
 
-bool text_fits(const String& txt, fontnum_t fontnum, int w) {
-    canvas.setFont(font[fontnum]);
-    if (canvas.textWidth(txt) <= w)
-        return true;
-    return false;
+bool text_fits(const char* txt, fontnum_t fontnum, int w) {
+    return text_width(txt, fontnum) <= w;
 }
 
-void auto_text(const String& txt, int x, int y, int w, int color, fontnum_t fontnum, int datum,
+void auto_text(const char* txt, int x, int y, int w, int color, fontnum_t fontnum, int datum,
                                   bool tryfonts, bool trimleft) {
     bool doesnotfit = true;
     while (true) { // forever loop
@@ -50,28 +52,40 @@ void auto_text(const String& txt, int x, int y, int w, int color, fontnum_t font
         else
             break;
     }
-    
-    String s(txt);
 
-    if (doesnotfit) {
-        int dotswidth = canvas.textWidth(" ...");
+    if (!doesnotfit) {
+        text(txt, x, y, color, fontnum, datum);
+        return;
+    }
+
+    // Trim characters from one end until the rest plus " ..." fits
+    char   piece[80];
+    size_t len       = std::min(strlen(txt), sizeof(piece) - 1);
+    int    dotswidth = text_width(" ...", fontnum);
+    bool   trimmed   = false;
+    memcpy(piece, trimleft ? txt + strlen(txt) - len : txt, len);
+    piece[len] = '\0';
 
-        while (s.length() > 4) {
-            if (trimleft)
-                s.remove(0,1);
-            else
-                s.remove(s.length()-1);
-            if (canvas.textWidth(s)+dotswidth <= w) {
-                if (trimleft) {
-                    s = String("... " + s);
-                    USBSerial.printf("trimleft: %s\r\n", s.c_str());
-                } else {
-                    s.concat(" ...");
-                }
-                break;
-            }
+    while (len > 4) {
+        if (trimleft)
+            memmove(piece, piece + 1, len);
+        else
+            piece[len - 1] = '\0';
+        --len;
+        if (text_width(piece, fontnum) + dotswidth <= w) {
+            trimmed = true;
+            break;
         }
     }
 
-    text(s, x, y, color, fontnum, datum);
+    StackBuf<sizeof(piece) + 4> s;
+    if (trimmed && trimleft) {
+        s.add("... ");
+    }
+    s.add(piece);
+    if (trimmed && !trimleft) {
+        s.add(" ...");
     }
+
+    text(s, x, y, color, fontnum, datum);
+}
@@ -15,11 +15,29 @@ enum fontnum_t {
     MEDIUM_MONO = 4,
 };
 
-bool text_fits(const String& txt, fontnum_t fontnum, int w);
+bool text_fits(const char* txt, fontnum_t fontnum, int w);
 // adjusts text to fit in (w) display area. reduces font size until it. tryfonts::false just uses fontnum
-void auto_text(const String& txt, int x, int y, int w, int color, fontnum_t fontnum = MEDIUM,
+void auto_text(const char* txt, int x, int y, int w, int color, fontnum_t fontnum = MEDIUM,
                int datum = middle_center, bool tryfonts = true, bool trimleft = false);
 
-void text(const String& msg, int x, int y, int color, fontnum_t fontnum = TINY, int datum = middle_center);
-void text(const String& msg, Point xy, int color, fontnum_t fontnum = TINY, int datum = middle_center);
-void centered_text(const String& msg, int y, int color = WHITE, fontnum_t fontnum = TINY);
+void text(const char* msg, int x, int y, int color, fontnum_t fontnum = TINY, int datum = middle_center);
+void text(const char* msg, Point xy, int color, fontnum_t fontnum = TINY, int datum = middle_center);
+void centered_text(const char* msg, int y, int color = WHITE, fontnum_t fontnum = TINY);
+
+// String versions, for callers that already have a String
+inline bool text_fits(const String& txt, fontnum_t fontnum, int w) {
+    return text_fits(txt.c_str(), fontnum, w);
+}
+inline void auto_text(const String& txt, int x, int y, int w, int color, fontnum_t fontnum = MEDIUM,
+                      int datum = middle_center, bool tryfonts = true, bool trimleft = false) {
+    auto_text(txt.c_str(), x, y, w, color, fontnum, datum, tryfonts, trimleft);
+}
+inline void text(const String& msg, int x, int y, int color, fontnum_t fontnum = TINY, int datum = middle_center) {
+    text(msg.c_str(), x, y, color, fontnum, datum);
+}
+inline void text(const String& msg, Point xy, int color, fontnum_t fontnum = TINY, int datum = middle_center) {
+    text(msg.c_str(), xy, color, fontnum, datum);
+}
+inline void centered_text(const String& msg, int y, int color = WHITE, fontnum_t fontnum = TINY) {
+    centered_text(msg.c_str(), y, color, fontnum);
+}
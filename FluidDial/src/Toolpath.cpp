@@ -0,0 +1,379 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "Toolpath.h"
+#include "FileParser.h"    // request_toolpath_lines()
+#include "FNCIngest.h"     // post_fnc_event()
+#include "FluidNCModel.h"  // state
+#include "Scene.h"         // current_scene
+#include "System.h"        // canvas
+#include "Format.h"        // StackBuf
+#include "GcodeInterp.h"
+#include "JobEstimate.h"
+
+#include <atomic>
+#include <math.h>
+#include <algorithm>
+
+// The sprite covers the screen; the path is fitted into a square that
+// lies inside the round part of it
+constexpr static const int   THUMB_SIZE       = 240;
+constexpr static const int   PATH_SIZE        = 160;
+constexpr static const float TOLERANCE_PX     = 0.5f;  // Most a drawn line strays from the path
+
+// Palette indices of the 2-bit sprite
+enum { BG_INDEX, CUT_INDEX, RAPID_INDEX, FRAME_INDEX };
+
+enum pass_t : uint8_t { BOUNDS, DRAW };
+
+// Set by the UI before it requests a pass and read by the ingest task
+// during the pass
+static pass_t pass;
+static float  scale;
+static float  center_x;
+static float  center_y;
+
+// Set by the ingest task during a bounds pass and read by the UI after it ends
+static float min_x;
+static float min_y;
+static float max_x;
+static float max_y;
+static bool  have_bounds;
+
+static std::atomic<int> lines_seen { 0 };
+
+// Ingest side
+
+// Reumann-Witkam simplification, in pixels, one point at a time.  A
+// drawn segment is extended for as long as the path stays within
+// TOLERANCE_PX of the line through its start in its first direction.
+class PathSimplifier {
+private:
+    float _sx, _sy;  // Start of the segment being extended
+    float _lx, _ly;  // Last point on it
+    float _dx, _dy;  // Unit direction, once the path has moved far enough
+    bool  _have_dir = false;
+    bool  _rapid    = false;
+
+    toolpath_batch* _batch = nullptr;
+
+    void emit() {
+        if (_lx == _sx && _ly == _sy) {
+            return;
+        }
+        if (!_batch) {
+            _batch = new toolpath_batch;
+        }
+        auto& s = _batch->segments[_batch->n++];
+        s.x0    = lroundf(_sx);
+        s.y0    = lroundf(_sy);
+        s.x1    = lroundf(_lx);
+        s.y1    = lroundf(_ly);
+        s.rapid = _rapid;
+        if (_batch->n == toolpath_batch::SIZE) {
+            flush_batch();
+        }
+    }
+    void restart() {
+        _sx       = _lx;
+        _sy       = _ly;
+        _have_dir = false;
+    }
+
+public:
+    void reset() {
+        _sx = _sy = _lx = _ly = 0;
+        _have_dir = false;
+        _rapid    = false;
+    }
+    void move_to(float x, float y) {
+        emit();
+        _lx = x;
+        _ly = y;
+        restart();
+    }
+    void line_to(float x, float y, bool rapid) {
+        if (rapid != _rapid) {
+            emit();
+            restart();
+            _rapid = rapid;
+        }
+        if (_have_dir) {
+            float px       = x - _sx;
+            float py       = y - _sy;
+            float off_line = fabsf(px * _dy - py * _dx);
+            float along    = px * _dx + py * _dy;
+            float last     = (_lx - _sx) * _dx + (_ly - _sy) * _dy;
+            if (off_line <= TOLERANCE_PX && along >= last - TOLERANCE_PX) {
+                _lx = x;
+                _ly = y;
+                return;
+            }
+            emit();
+            restart();
+        }
+        float dist = hypotf(x - _sx, y - _sy);
+        if (dist >= TOLERANCE_PX) {
+            _dx       = (x - _sx) / dist;
+            _dy       = (y - _sy) / dist;
+            _have_dir = true;
+        }
+        _lx = x;
+        _ly = y;
+    }
+    void flush() {
+        emit();
+        restart();
+        flush_batch();
+    }
+    void flush_batch() {
+        if (_batch) {
+            fnc_event_t event;
+            event.type     = EV_TOOLPATH;
+            event.toolpath = _batch;
+            // Every segment should reach the UI, so wait for room
+            if (!post_fnc_event_wait(event)) {
+                delete _batch;  // The UI has stalled, so the thumbnail misses these
+            }
+            _batch = nullptr;  // Now owned by the UI
+        }
+    }
+} simplifier;
+
+// Follows the path for the current pass.  The scan pass also feeds the
+// job time estimate.
+class ToolpathSink : public GcodeSink {
+private:
+    void point(const gcode_point& p, bool draw, bool rapid) {
+        if (pass == BOUNDS) {
+            if (!have_bounds) {
+                min_x = max_x = p.x;
+                min_y = max_y = p.y;
+                have_bounds   = true;
+            }
+            min_x = std::min(min_x, p.x);
+            max_x = std::max(max_x, p.x);
+            min_y = std::min(min_y, p.y);
+            max_y = std::max(max_y, p.y);
+            return;
+        }
+        float px = THUMB_SIZE / 2 + (p.x - center_x) * scale;
+        float py = THUMB_SIZE / 2 - (p.y - center_y) * scale;
+        if (draw) {
+            simplifier.line_to(px, py, rapid);
+        } else {
+            simplifier.move_to(px, py);
+        }
+    }
+
+public:
+    void jump(const gcode_point& to) override {
+        point(to, false, false);
+        if (pass == BOUNDS) {
+            estimate_sink().jump(to);
+        }
+    }
+    void move(const gcode_point& to, bool rapid, float feed) override {
+        point(to, true, rapid);
+        if (pass == BOUNDS) {
+            estimate_sink().move(to, rapid, feed);
+        }
+    }
+    void dwell(float seconds) override {
+        if (pass == BOUNDS) {
+            estimate_sink().dwell(seconds);
+        }
+    }
+    int arc_steps(float radius, float angle) override {
+        if (pass == BOUNDS) {
+            // The estimate follows arcs the way FluidNC does
+            return estimate_sink().arc_steps(radius, angle);
+        }
+        // Chords whose sagitta is within the tolerance
+        float r_px = radius * scale;
+        float step = r_px > TOLERANCE_PX ? 2 * acosf(1 - TOLERANCE_PX / r_px) : M_PI;
+        return ceilf(angle / step);
+    }
+} toolpath_sink;
+
+static GcodeInterp interp;
+static uint32_t    bytes_seen;
+static int         chunk_lines;      // In the chunk being streamed
+static bool        in_pass = false;  // Begun and not yet ended
+
+void toolpath_begin_chunk(int first) {
+    chunk_lines = 0;
+    if (first) {
+        return;  // The interpreter carries on from the last chunk
+    }
+    interp.reset(&toolpath_sink);
+    simplifier.reset();
+    lines_seen = 0;
+    bytes_seen = 0;
+    in_pass    = true;
+    if (pass == BOUNDS) {
+        have_bounds = false;
+        estimate_begin();
+    }
+}
+
+void toolpath_line(const char* line) {
+    ++chunk_lines;
+    ++lines_seen;
+    if (pass == BOUNDS) {
+        estimate_line(lines_seen, bytes_seen);
+        bytes_seen += strlen(line) + 1;
+    }
+    interp.line(line);
+}
+
+void toolpath_end_chunk(bool failed) {
+    bool ended = failed || chunk_lines < TOOLPATH_CHUNK;
+    if (ended && in_pass) {
+        in_pass = false;
+        if (pass == BOUNDS) {
+            estimate_end();
+        } else {
+            simplifier.flush();
+        }
+    } else if (pass == DRAW) {
+        simplifier.flush_batch();  // So the thumbnail fills in between chunks
+    }
+    fnc_event_t event;
+    event.type  = EV_TOOLPATH_END;
+    event.value = ended;
+    post_fnc_event_wait(event);  // Not a batch, so it has the reserved slots
+}
+
+// UI side
+
+enum toolpath_state_t {
+    TP_OFF,
+    TP_WANT_BOUNDS,  // Waiting for the link to be free
+    TP_BOUNDS,
+    TP_WANT_DRAW,
+    TP_DRAW,
+    TP_DONE,
+    TP_EMPTY,  // No XY moves in the file
+};
+
+static toolpath_state_t state_tp   = TP_OFF;
+static M5Canvas*        thumb      = nullptr;  // From the sprite pool while open
+static int              next_line  = 0;        // First line of the next chunk of the pass
+static bool             want_chunk = false;    // Ask for it once the link is free
+
+void toolpath_open() {
+    toolpath_close();
+
+    thumb = get_sprite(THUMB_SIZE, THUMB_SIZE, lgfx::palette_2bit);
+    if (!thumb) {
+        return;
+    }
+    thumb->createPalette();
+    thumb->setPaletteColor(BG_INDEX, 0x000000u);
+    thumb->setPaletteColor(CUT_INDEX, 0x40ff40u);
+    thumb->setPaletteColor(RAPID_INDEX, 0x6060a0u);
+    thumb->setPaletteColor(FRAME_INDEX, 0x303030u);
+    thumb->fillSprite(BG_INDEX);
+
+    request_motion_settings();  // Before the scan pass, which uses them
+    state_tp = TP_WANT_BOUNDS;
+    toolpath_poll();
+}
+
+void toolpath_close() {
+    if (state_tp != TP_OFF) {
+        // No more chunks are asked for; one that is streaming is ignored
+        release_sprite(thumb);
+        thumb      = nullptr;
+        state_tp   = TP_OFF;
+        want_chunk = false;
+    }
+}
+
+void toolpath_poll() {
+    bool start = state_tp == TP_WANT_BOUNDS || state_tp == TP_WANT_DRAW;
+    if ((!start && !want_chunk) || state != Idle || !file_lines_idle()) {
+        return;
+    }
+    if (start) {
+        // The ingest task is not in a pass, so this can be changed
+        pass      = state_tp == TP_WANT_BOUNDS ? BOUNDS : DRAW;
+        next_line = 0;
+    }
+    if (!request_toolpath_lines(next_line)) {
+        return;  // The link is busy, so try again on the next poll
+    }
+    want_chunk = false;
+    if (state_tp == TP_WANT_BOUNDS) {
+        estimate_forget();
+        state_tp = TP_BOUNDS;
+    } else if (state_tp == TP_WANT_DRAW) {
+        state_tp = TP_DRAW;
+    }
+}
+
+bool toolpath_draw() {
+    if (state_tp != TP_DRAW && state_tp != TP_DONE) {
+        return false;
+    }
+    thumb->pushSprite(&canvas, 0, 0);
+    return true;
+}
+
+const char* toolpath_status() {
+    static StackBuf<32> status;
+    status.clear();
+    switch (state_tp) {
+        case TP_WANT_BOUNDS:
+        case TP_BOUNDS:
+            status.add("Scanning ").addInt(lines_seen).add(" lines");
+            break;
+        case TP_EMPTY:
+            status.add("No toolpath");
+            break;
+        default:
+            break;
+    }
+    return status.c_str();
+}
+
+void accept_toolpath(toolpath_batch* batch) {
+    if (state_tp == TP_DRAW) {
+        for (int i = 0; i < batch->n; i++) {
+            auto& s = batch->segments[i];
+            thumb->drawLine(s.x0, s.y0, s.x1, s.y1, s.rapid ? RAPID_INDEX : CUT_INDEX);
+        }
+        current_scene->onToolpath();
+    }
+    delete batch;
+}
+
+void accept_toolpath_end(bool pass_ended) {
+    toolpath_stream_done();
+    if (!pass_ended) {
+        if (state_tp == TP_BOUNDS || state_tp == TP_DRAW) {
+            next_line += TOOLPATH_CHUNK;
+            want_chunk = true;
+        }
+    } else if (state_tp == TP_BOUNDS) {
+        estimate_finished();
+        if (!have_bounds) {
+            state_tp = TP_EMPTY;
+        } else {
+            float span = std::max(max_x - min_x, max_y - min_y);
+            scale      = span > 0 ? PATH_SIZE / span : 1.0f;
+            center_x   = (min_x + max_x) / 2;
+            center_y   = (min_y + max_y) / 2;
+
+            int half = PATH_SIZE / 2 + 2;
+            thumb->drawRect(THUMB_SIZE / 2 - half, THUMB_SIZE / 2 - half, 2 * half, 2 * half, FRAME_INDEX);
+            state_tp = TP_WANT_DRAW;
+        }
+    } else if (state_tp == TP_DRAW) {
+        state_tp = TP_DONE;
+    }
+    // This also picks up a request that waited for the link
+    toolpath_poll();
+    current_scene->onToolpath();
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// XY toolpath thumbnail of the previewed file.  The whole file is
+// streamed through a small G-code interpreter twice, first to find the
+// extent of the path and then to draw it scaled to fit.  Neither pass
+// keeps the lines, so any size of file works, and the thumbnail fills
+// in while the second pass streams.  Each pass asks for TOOLPATH_CHUNK
+// lines at a time, and only while the thumbnail is open and the machine
+// is idle, so other commands never wait for more than one chunk.
+
+#pragma once
+#include <Arduino.h>
+
+struct toolpath_segment {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+    bool    rapid;
+};
+
+constexpr static const int TOOLPATH_CHUNK = 256;
+
+// Drawn segments go to the UI in batches
+struct toolpath_batch {
+    constexpr static const int SIZE = 64;
+
+    int              n = 0;
+    toolpath_segment segments[SIZE];
+};
+
+// Ingest side, called with each chunk of a streamed pass.  A chunk that
+// starts at line 0 starts the pass, and a short or failed one ends it.
+void toolpath_begin_chunk(int first);
+void toolpath_line(const char* line);
+void toolpath_end_chunk(bool failed);
+
+// UI side
+void toolpath_open();   // Start on current_filename
+void toolpath_close();  // Stop and free the thumbnail
+void toolpath_poll();   // Request the next chunk once the link is free
+bool toolpath_draw();   // Draw the thumbnail onto the canvas, if there is one
+
+// Short description of the progress, for when there is nothing to show
+const char* toolpath_status();
+
+void accept_toolpath(toolpath_batch* batch);
+void accept_toolpath_end(bool pass_ended);
@@ -6,6 +6,12 @@
 #include "FluidNCModel.h"
 #include "FileParser.h"
 #include "Scene.h"
+#include "Profiler.h"
+#include "JogLatency.h"
+#include "LinkHealth.h"
+#include "InputEvents.h"
+#include "FNCIngest.h"
+#include "EventLoop.h"
 
 HardwareSerial Serial_FNC(1);  // Serial port for comm with FNC
 
@@ -13,12 +19,14 @@ extern "C" int milliseconds() {
     return millis();
 }
 extern "C" void fnc_putchar(uint8_t c) {
+    link_sent(c);
     Serial_FNC.write(c);
 }
 
 extern "C" int fnc_getchar() {
     if (Serial_FNC.available()) {
         update_rx_time();
+        link_received();
         int c = Serial_FNC.read();
         log_write(c);  // echo
         return c;
@@ -26,6 +34,26 @@ extern "C" int fnc_getchar() {
     return -1;
 }
 
+static TaskHandle_t loop_task = nullptr;
+
+// The loop task blocks on its task notification in event_wait() and
+// event_wake() gives the notification, from an ISR or from another task.
+extern "C" void event_sleep(int timeout_ms) {
+    ulTaskNotifyTake(pdTRUE, timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+extern "C" void IRAM_ATTR event_kick() {
+    if (!loop_task) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(loop_task, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(loop_task);
+    }
+}
+
 void drawSplashScreen() {
     display.clear();
     display.fillScreen(BLACK);
@@ -33,6 +61,8 @@ void drawSplashScreen() {
 }
 
 void setup() {
+    loop_task = xTaskGetCurrentTaskHandle();
+
     init_system();
 
     pinMode(GPIO_NUM_46, OUTPUT);
@@ -42,8 +72,13 @@ void setup() {
     redButton.init(RED_BUTTON_PIN, true);
     dialButton.init(DIAL_BUTTON_PIN, true);
 
+    // A larger RX buffer absorbs long file listings while the ingest task is busy
+    Serial_FNC.setRxBufferSize(2048);
     Serial_FNC.begin(115200, SERIAL_8N1, FNC_RX_PIN, FNC_TX_PIN);
 
+    init_listener();
+    start_fnc_ingest();
+
     drawSplashScreen();
     delay(3000);  // view the logo and wait for the debug port to connect
 
@@ -55,22 +90,58 @@ void setup() {
 
     extern Scene* initMenus();
     activate_scene(initMenus());
-    init_listener();
     init_file_list();
+
+    show_memory_usage();
 }
 
 void loop() {
+    profile_begin(PROF_LOOP);
+
+    profile_begin(PROF_DISPATCH);
     dispatch_events();
+    profile_end(PROF_DISPATCH);
 
     while (debugPort.available()) {
         char c = debugPort.read();
+        if (input_replay_command(c)) {
+            continue;  // A trace to replay is being read
+        }
         if (c == 'R' || c == 'r') {
             ESP.restart();
             while (1) {}
         }
+        if (c == 'M' || c == 'm') {
+            show_memory_usage();
+            prefs_report();
+        }
+        if (c == 'P' || c == 'p') {
+            profile_set_streaming(!profile_streaming());
+        }
+        if (c == 'L' || c == 'l') {
+            jog_latency_report();
+        }
+        if (c == 'H' || c == 'h') {
+            link_report();
+        }
+        if (c == 'I' || c == 'i') {
+            input_set_recording(!input_recording());
+        }
     }
 
-    while (Serial_FNC.available()) {
-        fnc_poll();  // Handle messages from FluidNC
-    }
+    // Messages from FluidNC are parsed on the ingest task; apply the results
+    profile_begin(PROF_POLL);
+    dispatch_fnc_events();
+    profile_end(PROF_POLL);
+
+    profile_poll();
+    profile_end(PROF_LOOP);
+    profile_loop_tick();
+
+    // Sleep until an input, FluidNC data or a deadline wakes us.  Keep
+    // polling at 1 ms while a button is debouncing or the panel is
+    // being touched, since those state machines are driven by time.
+    bool busy = greenButton.busy() || redButton.busy() || dialButton.busy() || touch.getDetail().state != m5::touch_state_t::none;
+    event_wake_within(busy ? 1 : IDLE_WAKE_MS);
+    event_wait();
 }
@@ -3,11 +3,59 @@
 
 #include <Arduino.h>
 #include "Scene.h"
+#include "Profiler.h"
+#include "LinkHealth.h"
 
 extern Scene menuScene;
 
 class SetupScene : public Scene {
 private:
+    enum page_t { PAGE_INFO, PAGE_PROFILE, PAGE_LINK, N_PAGES };
+    int _page = PAGE_INFO;  // Hidden pages, cycled by touch-and-hold
+
+    void drawProfile() {
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%u loops/s", profile_loops_per_second());
+        centered_text(buf, 73, LIGHTGREY, TINY);
+        centered_text("avg / p99 us, allocs", 95, LIGHTGREY, TINY);
+        int y = 117;
+        for (int i = 0; i < PROF_NPHASES; i++) {
+            profile_stats_t stats;
+            profile_get_stats((profile_phase_t)i, stats);
+            snprintf(buf,
+                     sizeof(buf),
+                     "%s %u / %u, %u",
+                     profile_phase_name((profile_phase_t)i),
+                     stats.avg_us,
+                     stats.p99_us,
+                     stats.allocs);
+            centered_text(buf, y, GREEN, TINY);
+            y += 18;
+        }
+    }
+
+    void drawLink() {
+        link_stats_t s;
+        link_get_stats(s);
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%u reports, %u bytes", s.reports, s.rx_bytes);
+        centered_text(buf, 73, LIGHTGREY, TINY);
+        snprintf(buf, sizeof(buf), "rtt %u / %u / %u ms", s.rtt_min_ms, s.rtt_avg_ms, s.rtt_max_ms);
+        centered_text(buf, 95, GREEN, TINY);
+        snprintf(buf, sizeof(buf), "gap %u / %u ms", s.gap_avg_ms, s.gap_max_ms);
+        centered_text(buf, 113, GREEN, TINY);
+        snprintf(buf, sizeof(buf), "ping %d wait %d ms", link_ping_interval_ms(), link_response_ms());
+        centered_text(buf, 131, GREEN, TINY);
+
+        // Errors in red once there are any
+        snprintf(buf, sizeof(buf), "lost %u bad %u", s.lost, s.malformed);
+        centered_text(buf, 149, s.lost || s.malformed ? RED : GREEN, TINY);
+        snprintf(buf, sizeof(buf), "timeouts %u", s.timeouts);
+        centered_text(buf, 167, s.timeouts ? RED : GREEN, TINY);
+        snprintf(buf, sizeof(buf), "overrun %u rx err %u", s.overruns, s.rx_errors);
+        centered_text(buf, 185, s.overruns || s.rx_errors ? RED : GREEN, TINY);
+    }
+
 public:
     SetupScene() : Scene("Setup") {}
 
@@ -24,12 +72,34 @@ public:
         }
     }
 
+    void onTouchHold(int x, int y) override {
+        _page = (_page + 1) % N_PAGES;
+        reDisplay();
+    }
+
     void onEncoder(int delta) {}
     void onStateChange(state_t state) { reDisplay(); }
+    void onDROChange() {
+        if (_page != PAGE_INFO) {
+            reDisplay();
+        }
+    }
     void reDisplay() {
         drawBackground(BLACK);
         drawStatus();
 
+        if (_page != PAGE_INFO) {
+            if (_page == PAGE_PROFILE) {
+                drawProfile();
+            } else {
+                drawLink();
+            }
+            drawMenuTitle(current_scene->name());
+            drawButtonLegends("", "", "Menu");
+            refreshDisplay();
+            return;
+        }
+
         centered_text("GCode modes:", 73, LIGHTGREY, TINY);
         centered_text(modeString(), 91, GREEN, TINY);
 
@@ -0,0 +1,167 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+// Host tests for JsonScanner: pio test -e native
+//
+// FluidNC splits a JSON document across [MSG:JSON: lines at arbitrary
+// places, so every document is fed in two pieces, split at every
+// position, and must give the same callbacks as when fed whole.  The
+// throughput test prints MB/s for a file listing.
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include "JsonScanner.h"
+
+// Writes every callback into a log, for comparing runs
+class LogHandler : public JsonScanner::Handler {
+public:
+    std::string log;
+
+    void start(char type, int depth) override { log += std::string("S") + type + std::to_string(depth) + ' '; }
+    void end(char type, int depth) override { log += std::string("E") + type + std::to_string(depth) + ' '; }
+    void key(const char* key, int depth) override { log += "K" + std::to_string(depth) + '<' + key + "> "; }
+    void value(const char* value, bool quoted, int depth) override {
+        log += (quoted ? "Q" : "V") + std::to_string(depth) + '<' + value + "> ";
+    }
+    void end_document() override { log += "D "; }
+    void error() override { log += "X "; }
+};
+
+// Counts callbacks, so the benchmark measures the scanner and not the log
+class CountHandler : public JsonScanner::Handler {
+public:
+    uint32_t count = 0;
+
+    void key(const char* key, int depth) override { ++count; }
+    void value(const char* value, bool quoted, int depth) override { ++count; }
+    void end_document() override { ++count; }
+};
+
+static const char* listing = "{\"files\":[{\"name\":\"part 1.nc\",\"size\":\"12345\"},"
+                             "{\"name\":\"dir\",\"size\":\"-1\"},"
+                             "{\"name\":\"caf\\u00e9 \\\"q\\\".gcode\",\"size\":\"7\"}],"
+                             "\"path\":\"/sd\",\"total\":123456789,\"used\":-1.5e3}";
+
+static const char* mixed = "[true, false, null, [1, [2, {}]], {\"a\": [\"\\n\\t\\\\\\/\"]}]";
+
+static std::string parse_whole(const char* doc) {
+    LogHandler  handler;
+    JsonScanner scanner(handler);
+    scanner.parse(doc);
+    return handler.log;
+}
+
+// Each piece goes through a buffer that is clobbered afterwards, as the
+// line buffer of GrblParserC is, so nothing may point into it
+static void check_splits(const char* doc) {
+    std::string whole = parse_whole(doc);
+    TEST_ASSERT_TRUE(whole.find("D ") != std::string::npos);
+    TEST_ASSERT_TRUE(whole.find("X ") == std::string::npos);
+
+    size_t len = strlen(doc);
+    for (size_t split = 0; split <= len; split++) {
+        LogHandler  handler;
+        JsonScanner scanner(handler);
+        std::string piece(doc, split);
+        scanner.parse(piece.c_str());
+        piece.assign(piece.size(), '#');
+        piece = std::string(doc + split);
+        scanner.parse(piece.c_str());
+        char msg[32];
+        snprintf(msg, sizeof(msg), "split at %u", (unsigned)split);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(whole.c_str(), handler.log.c_str(), msg);
+    }
+}
+
+void test_listing_splits() {
+    check_splits(listing);
+}
+
+void test_mixed_splits() {
+    check_splits(mixed);
+}
+
+void test_values() {
+    std::string log = parse_whole(listing);
+    TEST_ASSERT_TRUE(log.find("Q3<part 1.nc>") != std::string::npos);
+    TEST_ASSERT_TRUE(log.find("Q3<caf\xc3\xa9 \"q\".gcode>") != std::string::npos);
+    TEST_ASSERT_TRUE(log.find("V1<123456789>") != std::string::npos);
+    TEST_ASSERT_TRUE(log.find("V1<-1.5e3>") != std::string::npos);
+}
+
+// After each document the scanner is ready for the next one
+void test_consecutive_documents() {
+    std::string twice = std::string(listing) + mixed;
+    TEST_ASSERT_EQUAL_STRING((parse_whole(listing) + parse_whole(mixed)).c_str(), parse_whole(twice.c_str()).c_str());
+}
+
+// An error skips the rest of the document, then the next one parses
+void test_error_recovery() {
+    std::string log = parse_whole("{\"a\":}");
+    TEST_ASSERT_TRUE(log.find("X ") != std::string::npos);
+    std::string after = std::string("{\"a\":}") + mixed;
+    std::string both  = parse_whole(after.c_str());
+    TEST_ASSERT_TRUE(both.find(parse_whole(mixed)) != std::string::npos);
+}
+
+// An error in the middle of a listing skips to its end, past brackets
+// and quotes in strings, without finding a document in what is left
+void test_error_mid_listing() {
+    const char* broken[] = {
+        "{\"files\":[{\"name\":\"a.nc\"},{\"name\" \"b]}.nc\",\"size\":\"1\"},{\"name\":\"c.nc\"}],\"path\":\"/sd\"}",
+        "{\"files\":[{\"name\":\"a\\\"]}{.nc\",\"size\":},{\"name\":\"c.nc\"}]}",
+        "{\"file_lines\":[\"G0 X\\u00zz]}\",\"{G1}\"],\"path\":\"/sd/a.nc\"}",
+        "{\"files\":[{\"name\":\"a.nc\"]},{\"name\":\"c.nc\"}]}",
+    };
+    std::string expected = parse_whole(mixed);
+    for (const char* doc : broken) {
+        std::string log = parse_whole((std::string(doc) + mixed).c_str());
+        size_t      x   = log.find("X ");
+        TEST_ASSERT_TRUE_MESSAGE(x != std::string::npos, doc);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.c_str(), log.substr(x + 2).c_str(), doc);
+    }
+}
+
+void test_throughput() {
+    // A listing of 200 files, about the largest directory in practice
+    std::string doc = "{\"files\":[";
+    for (int i = 0; i < 200; i++) {
+        char entry[80];
+        snprintf(entry, sizeof(entry), "%s{\"name\":\"job_%03d_roughing.nc\",\"size\":\"%d\"}", i ? "," : "", i, 1000 + 37 * i);
+        doc += entry;
+    }
+    doc += "],\"path\":\"/sd/jobs\",\"total\":\"16.0GB\",\"used\":\"1.2GB\"}";
+
+    CountHandler handler;
+    JsonScanner  scanner(handler);
+    const int    passes = 200;
+    auto         start  = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++) {
+        scanner.parse(doc.c_str());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Four callbacks per file, seven for the keys and values around the list, one for the end
+    TEST_ASSERT_EQUAL_UINT32(passes * (200 * 4 + 7 + 1), handler.count);
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%.1f MB/s, %u bytes x %d", doc.size() * passes / seconds / 1e6, (unsigned)doc.size(), passes);
+    TEST_MESSAGE(msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_listing_splits);
+    RUN_TEST(test_mixed_splits);
+    RUN_TEST(test_values);
+    RUN_TEST(test_consecutive_documents);
+    RUN_TEST(test_error_recovery);
+    RUN_TEST(test_error_mid_listing);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -3,6 +3,7 @@
 
 #include "usart.h"
 #include "Expander.h"
+#include "EventLoop.h"
 #include "stm32f1xx_hal.h"
 #include "string.h"
 
@@ -31,15 +32,20 @@ void debug_putchar(char c) {
 
 // Interface routines for GrblParser
 
-// Receive a byte from the serial port connected to FluidNC
-int fnc_getchar() {
-    // The DMA-mode HAL UART driver receives data to a ring buffer.
-    // We chase the buffer pointer and pull out the data.
+// Number of received bytes waiting in the DMA ring buffer
+static int fnc_available() {
     int count = last_dma_count - __HAL_DMA_GET_COUNTER(FNCSerial->hdmarx);
     if (count < 0) {
         count += UART_DMA_LEN;
     }
-    if (count) {
+    return count;
+}
+
+// Receive a byte from the serial port connected to FluidNC
+int fnc_getchar() {
+    // The DMA-mode HAL UART driver receives data to a ring buffer.
+    // We chase the buffer pointer and pull out the data.
+    if (fnc_available()) {
         uint8_t c = dma_buf[UART_DMA_LEN - last_dma_count];
         --last_dma_count;
         if (last_dma_count < 0) {
@@ -92,12 +98,32 @@ void handle_other(char* line) {
     debug_println(line);
 }
 
+// The UART is serviced by DMA without per-byte interrupts, so the idle
+// line interrupt, one character time after the last byte of a burst,
+// is what wakes the loop for received data.  The HAL handler is not
+// used because it would abort the DMA ring on a receive error.
+void USART1_IRQHandler(void) {
+    // Reading SR then DR clears IDLE and any ORE/NE/FE that came with it
+    __HAL_UART_CLEAR_IDLEFLAG(FNCSerial);
+    event_wake(EV_WAKE_UART);
+}
+
+// Sleep until the next interrupt: received data, or the 1 ms SysTick,
+// which bounds the latency for input pin changes.
+void event_sleep(int timeout_ms) {
+    __WFI();
+}
+
 // Application initialization, called from main() in CubeMX/Core/Src/main.c after
 // the basic driver setup code that CubeMX generated has finished.
 void setup() {
     HAL_UART_Receive_DMA(FNCSerial, dma_buf, UART_DMA_LEN);
     last_dma_count = UART_DMA_LEN;
 
+    __HAL_UART_ENABLE_IT(FNCSerial, UART_IT_IDLE);
+    HAL_NVIC_SetPriority(USART1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(USART1_IRQn);
+
     debug_println("[MSG:INFO: Hello from STM32_Expander]");
     fnc_wait_ready();
     // XXX we need some sort of message to tell FluidNC that the
@@ -112,4 +138,7 @@ void setup() {
 // in CubeMX/Core/Src/main.c
 void loop() {
     fnc_poll();
+    if (!fnc_available()) {
+        event_wait();
+    }
 }
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include "GrblParser.h"
 #include <io_controller.h>
+#include "EventLoop.h"
 
 // https://github.com/stm32duino/Arduino_Core_STM32/wiki/
 
@@ -147,8 +148,21 @@ void setup() {
     // depend on FluidNC to be ready when the expander starts.
 }
 
+// Sleep until the next interrupt; the UART receive interrupt and the
+// 1 ms SysTick both end it, so input pins are still read every millisecond.
+extern "C" void event_sleep(int timeout_ms) {
+    __WFI();
+}
+
+extern "C" int milliseconds() {
+    return millis();
+}
+
 void loop() {
     displayer.poll();
+    if (!FNCSerial.available()) {
+        event_wait();
+    }
 }
 
 void send_pin_msg(int pin_num, bool active) {
@@ -0,0 +1,62 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#include "EventLoop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static volatile uint8_t _pending = 0;
+
+static bool _have_deadline = false;
+static int  _deadline_ms;
+
+static uint32_t _wake_count = 0;
+
+void event_wake(uint8_t sources) {
+    __atomic_fetch_or(&_pending, sources, __ATOMIC_SEQ_CST);
+    event_kick();
+}
+
+void event_wake_within(int ms) {
+    int deadline = milliseconds() + ms;
+    if (!_have_deadline || (deadline - _deadline_ms) < 0) {
+        _deadline_ms   = deadline;
+        _have_deadline = true;
+    }
+}
+
+uint8_t event_wait() {
+    uint8_t sources = __atomic_exchange_n(&_pending, 0, __ATOMIC_SEQ_CST);
+    if (!sources) {
+        int timeout = -1;
+        if (_have_deadline) {
+            timeout = _deadline_ms - milliseconds();
+            if (timeout < 0) {
+                timeout = 0;
+            }
+        }
+        if (timeout) {
+            event_sleep(timeout);
+        }
+        sources = __atomic_exchange_n(&_pending, 0, __ATOMIC_SEQ_CST);
+    }
+    if (_have_deadline && (milliseconds() - _deadline_ms) >= 0) {
+        sources |= EV_WAKE_TIMER;
+    }
+    _have_deadline = false;
+    ++_wake_count;
+    return sources;
+}
+
+uint32_t event_wake_count() {
+    return _wake_count;
+}
+
+void __attribute__((weak)) event_sleep(int timeout_ms) {}
+void __attribute__((weak)) event_kick() {}
+
+#ifdef __cplusplus
+}
+#endif
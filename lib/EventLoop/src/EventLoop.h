@@ -0,0 +1,58 @@
+// Copyright (c) 2023 Mitch Bradley
+// Use of this source code is governed by a GPLv3 license that can be found in the LICENSE file.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Event loop API
+//
+// Instead of spinning, an app's loop() does its work and then calls
+// event_wait(), which puts the MCU to sleep until something happens.
+// Interrupt handlers and other tasks call event_wake() to record why
+// the loop should run; the app can also ask for a timed wakeup with
+// event_wake_within().
+//
+// event_wait() may return early, for example when any interrupt
+// ends a WFI, so callers must always recheck their inputs.
+
+// Wake sources
+#define EV_WAKE_UART (1 << 0)     // Received data
+#define EV_WAKE_GPIO (1 << 1)     // Input pin changed
+#define EV_WAKE_TOUCH (1 << 2)    // Touch controller interrupt
+#define EV_WAKE_ENCODER (1 << 3)  // Encoder moved
+#define EV_WAKE_TIMER (1 << 4)    // Deadline from event_wake_within()
+
+// Record a wake source and wake the loop.  Safe to call from interrupt handlers.
+void event_wake(uint8_t sources);
+
+// Wake no later than ms milliseconds from now.  The earliest request
+// wins; requests are cleared each time event_wait() returns.
+void event_wake_within(int ms);
+
+// Sleep until event_wake() or a deadline.  Returns the wake sources
+// that were recorded, or 0 for an unattributed wakeup.
+uint8_t event_wait();
+
+// Number of times event_wait() has returned, for measuring idle behavior
+uint32_t event_wake_count();
+
+// Get the time in milliseconds, as for GrblParserC
+extern int milliseconds();  // Must implement
+
+// Implement these to sleep and wake on a particular platform.
+// event_sleep() must return no later than timeout_ms, or whenever
+// event_kick() is called; timeout_ms < 0 means no timeout.  The
+// default implementations do not sleep, which is the old spinning
+// behavior.
+extern void event_sleep(int timeout_ms);
+extern void event_kick();
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,6 +13,9 @@ extern "C" {
 static size_t _report_len = 0;
 static char   _report[REPORT_BUFFER_LEN];
 
+static bool _overflow = false;  // The line did not fit in _report
+static bool _garbled  = false;  // The line has control characters, as from line noise
+
 static bool _ackwait = false;
 static int  _ack_time_limit;
 
@@ -195,11 +198,13 @@ static void parse_status_report(char* field) {
     bool flood        = false;
     bool mist         = false;
     bool has_override = false;
+    bool has_buffers  = false;
 
     char* next;
     split(field, &next, '|');
     if (*next == '\0') {
-        return;  // Malformed report
+        show_malformed(field);
+        return;
     }
 
     char* state = field;
@@ -218,7 +223,8 @@ static void parse_status_report(char* field) {
     //unused values end
 
     // feedrate,spindle_speed
-    uint32_t           fs[2];
+    uint32_t           fs[2]           = { 0 };
+    uint32_t           bf[2]           = { 0 };
     override_percent_t frs[MAX_N_AXIS] = { 0 };
 
     size_t n_axis = 0;
@@ -246,11 +252,14 @@ static void parse_status_report(char* field) {
         }
         if (strcmp(field, "Bf") == 0) {
             // buf_avail,rx_avail
+            has_buffers = true;
+            parse_integers(value, bf, 2);  // planner blocks in [0], rx bytes in [1]
             continue;
         }
         if (strcmp(field, "Ln") == 0) {
             // n
-            linenum = atoi(value);
+            has_linenum = true;
+            linenum     = atoi(value);
             continue;
         }
         if (strcmp(field, "FS") == 0) {
@@ -354,6 +363,9 @@ static void parse_status_report(char* field) {
     if (has_linenum) {
         show_linenum(linenum);
     }
+    if (has_buffers) {
+        show_buffers(bf[0], bf[1]);
+    }
     if (has_a_field) {
         show_spindle_coolant(spindle, flood, mist);
     }
@@ -534,11 +546,24 @@ void collect(uint8_t data) {
         return;
     }
     if (c == '\n') {
-        parse_report();
+        if (_overflow || _garbled) {
+            show_malformed(_report);
+        } else {
+            parse_report();
+        }
         _report[0]  = '\0';
         _report_len = 0;
+        _overflow   = false;
+        _garbled    = false;
+        return;
+    }
+    if (_report_len == REPORT_BUFFER_LEN - 1) {
+        _overflow = true;
         return;
     }
+    if (data < ' ' && c != '\t') {
+        _garbled = true;
+    }
     _report[_report_len++] = c;
     _report[_report_len]   = '\0';
 }
@@ -564,6 +589,7 @@ void __attribute__((weak)) show_alarm(int alarm) {}
 void __attribute__((weak)) show_error(int error) {}
 void __attribute__((weak)) show_ok() {}
 void __attribute__((weak)) show_timeout() {}
+void __attribute__((weak)) show_malformed(const char* line) {}
 
 // Handle [MSG: messages
 // If you do not override it, it will handle IO expander messages.
@@ -581,6 +607,7 @@ void __attribute__((weak)) show_state(const char* state) {};
 void __attribute__((weak)) show_dro(const pos_t* axes, const pos_t* wcos, bool isMpos, bool* limits, size_t n_axis) {}
 void __attribute__((weak)) show_file(const char* filename, file_percent_t percent) {}
 void __attribute__((weak)) show_spindle_coolant(int spindle, bool flood, bool mist) {}
+void __attribute__((weak)) show_buffers(uint32_t planner_avail, uint32_t rx_avail) {}
 void __attribute__((weak)) show_feed_spindle(uint32_t feedrate, uint32_t spindle_speed) {}
 void __attribute__((weak)) show_overrides(override_percent_t feed_ovr, override_percent_t rapid_ovr, override_percent_t spindle_ovr) {}
 // [GC: messages
@@ -125,6 +125,10 @@ extern void show_alarm(int alarm);
 extern void show_ok();
 extern void show_timeout();
 
+// A line that was too long, had control characters, or was a status
+// report without fields.  Such lines are otherwise ignored.
+extern void show_malformed(const char* line);
+
 extern void expander_ack();
 extern void expander_nak(const char* msg);
 
@@ -150,6 +154,7 @@ extern void show_state(const char* state);
 extern void show_dro(const pos_t* axes, const pos_t* wcos, bool isMpos, bool* limits, size_t n_axis);
 extern void show_file(const char* filename, file_percent_t percent);
 extern void show_linenum(int linenum);
+extern void show_buffers(uint32_t planner_avail, uint32_t rx_avail);
 extern void show_spindle_coolant(int spindle, bool flood, bool mist);
 extern void show_feed_spindle(uint32_t feedrate, uint32_t spindle_speed);
 extern void show_overrides(override_percent_t feed_ovr, override_percent_t rapid_ovr, override_percent_t spindle_ovr);